@@ -168,60 +168,41 @@ int game_check_move(cgame g, uint i, uint j, square s) {
     if (check_square_value(g, i, j, s))  // If (i, j) square is s, that is a regular move
         return REGULAR;
 
-    uint mouv = REGULAR;
-    game copy = game_copy(g);
-    game_play_move(copy, i, j, s);
-
+    // The move is checked on g as if (i, j) was already s, so that g is only read
     if (s == TENT) {
-        // Losing move (no tent adj)
-        if (neigh_get_square(copy, i, j, TENT, !game_is_diagadj(copy))) {
-            game_delete(copy);
+        // Losing move (tent adj, (i, j) itself being around (i, j) on a small wrapping game)
+        bool diag = !game_is_diagadj(g);
+        if (neigh_get_square(g, i, j, TENT, diag) || neigh_count_coor(g, i, j, i, j, diag) > 0)
             return LOSING;
-        }
 
-        if (!neigh_get_square(copy, i, j, TREE, false)) {  // Tent no get tree -> losing
-            game_delete(copy);
+        if (!neigh_get_square(g, i, j, TREE, false))  // Tent no get tree -> losing
             return LOSING;
-        }
 
         // Losing move (current > expected)
-        if (game_get_current_nb_tents_all(g) >= game_get_expected_nb_tents_all(g)) {
-            game_delete(copy);
+        if (game_get_current_nb_tents_all(g) >= game_get_expected_nb_tents_all(g))
             return LOSING;
-        }
-        if (game_get_current_nb_tents_row(g, i) >= game_get_expected_nb_tents_row(g, i)) {
-            game_delete(copy);
+        if (game_get_current_nb_tents_row(g, i) >= game_get_expected_nb_tents_row(g, i))
             return LOSING;
-        }
-        if (game_get_current_nb_tents_col(g, j) >= game_get_expected_nb_tents_col(g, j)) {
-            game_delete(copy);
+        if (game_get_current_nb_tents_col(g, j) >= game_get_expected_nb_tents_col(g, j))
             return LOSING;
-        }
     }
 
     if (s == GRASS) {
         // Losing move (too much grass)
-        if (game_get_expected_nb_tents_row(g, i) - game_get_current_nb_tents_row(g, i) >= nb_square_row(g, i, EMPTY)) {
-            game_delete(copy);
+        if (game_get_expected_nb_tents_row(g, i) - game_get_current_nb_tents_row(g, i) >= nb_square_row(g, i, EMPTY))
             return LOSING;
-        }
-        if (game_get_expected_nb_tents_col(g, j) - game_get_current_nb_tents_col(g, j) >= nb_square_col(g, j, EMPTY)) {
-            game_delete(copy);
+        if (game_get_expected_nb_tents_col(g, j) - game_get_current_nb_tents_col(g, j) >= nb_square_col(g, j, EMPTY))
             return LOSING;
-        }
 
-        // If (i, j) is surrounded by grass -> losing
-        for (uint i = 0; i < game_nb_rows(g); i++)
-            for (uint j = 0; j < game_nb_cols(g); j++)
-                if (check_square_tree(copy, i, j))
-                    if (neigh_all_get_square(copy, i, j, GRASS)) {
-                        game_delete(copy);
+        // If a tree is surrounded by grass, (i, j) included -> losing
+        for (uint k = 0; k < game_nb_rows(g); k++)
+            for (uint l = 0; l < game_nb_cols(g); l++)
+                if (check_square_tree(g, k, l))
+                    if (neigh_count(g, k, l, GRASS, false) + neigh_count_coor(g, k, l, i, j, false) == neigh_count_valid(g, k, l))
                         return LOSING;
-                    }
     }
 
-    game_delete(copy);  // Frees the game copy
-    return mouv;
+    return REGULAR;
 }
 
 /* ************************************************************************** */
@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "header/game.h"
+#include "header/game_tools_ext.h"
+
+/* Solves in the background. The jobs wait in a queue (first in, first out) for one of the threads of the pool, which
+ * is created by the first job and lives as long as the process. A thread takes the first job of the queue and solves
+ * it with game_solve_budget, the job giving its cancel flag to the solver. Cancelling a job only sets that flag: a job
+ * still in the queue is then skipped by the thread taking it, and a running one is given up by the search.
+ * The state of the jobs and the queue are protected by the lock of the pool. The thread running a job calls its
+ * on_done callback before marking it done, so that a job waited for or polled as done has had its callback called.
+ */
+
+typedef enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE } job_state;
+
+struct solve_job_s {
+    game g;
+    solver_options opts;
+    solve_done_callback on_done;
+    void *user_data;
+    int cancel;  // Set (atomically) by game_solve_cancel
+    job_state state;
+    solve_status status;
+    struct solve_job_s *next;  // Next job of the queue
+};
+
+typedef struct async_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t queued;  // Signaled when a job enters the queue
+    pthread_cond_t done;    // Broadcast when a job is done
+    solve_job head, tail;   // Queue of the jobs waiting for a thread
+} async_pool;
+
+static async_pool pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL};
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void *run_jobs(void *arg) {
+    (void)arg;
+    while (true) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.head == NULL)
+            pthread_cond_wait(&pool.queued, &pool.lock);
+        solve_job job = pool.head;
+        pool.head = job->next;
+        if (pool.head == NULL)
+            pool.tail = NULL;
+        job->state = JOB_RUNNING;
+        pthread_mutex_unlock(&pool.lock);
+
+        if (__atomic_load_n(&job->cancel, __ATOMIC_RELAXED))  // Cancelled while in the queue
+            job->status = SOLVE_CANCELLED;
+        else
+            job->status = game_solve_budget(job->g, &job->opts);
+        if (job->on_done != NULL)
+            job->on_done(job->g, job->status, job->user_data);
+
+        pthread_mutex_lock(&pool.lock);
+        job->state = JOB_DONE;
+        pthread_cond_broadcast(&pool.done);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+// Creates the threads of the pool, one per processor
+static void start_pool(void) {
+    long nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_threads < 1)
+        nb_threads = 1;
+    for (long t = 0; t < nb_threads; t++) {
+        pthread_t thread;
+        int err = pthread_create(&thread, NULL, run_jobs, NULL);
+        assert(err == 0);
+        (void)err;
+        pthread_detach(thread);
+    }
+}
+
+solve_job game_solve_async(game g, const solver_options *opts, solve_done_callback on_done, void *user_data) {
+    assert(g && opts);
+    pthread_once(&pool_once, start_pool);
+    solve_job job = malloc(sizeof(struct solve_job_s));
+    assert(job);
+    job->g = g;
+    job->opts = *opts;
+    job->opts.cancel = &job->cancel;
+    job->on_done = on_done;
+    job->user_data = user_data;
+    job->cancel = 0;
+    job->state = JOB_QUEUED;
+    job->status = SOLVE_UNSAT;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.tail != NULL)
+        pool.tail->next = job;
+    else
+        pool.head = job;
+    pool.tail = job;
+    pthread_cond_signal(&pool.queued);
+    pthread_mutex_unlock(&pool.lock);
+    return job;
+}
+
+void game_solve_cancel(solve_job job) {
+    assert(job);
+    __atomic_store_n(&job->cancel, 1, __ATOMIC_RELAXED);
+}
+
+bool game_solve_poll(solve_job job) {
+    assert(job);
+    pthread_mutex_lock(&pool.lock);
+    bool done = job->state == JOB_DONE;
+    pthread_mutex_unlock(&pool.lock);
+    return done;
+}
+
+solve_status game_solve_wait(solve_job job) {
+    assert(job);
+    pthread_mutex_lock(&pool.lock);
+    while (job->state != JOB_DONE)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    solve_status status = job->status;
+    free(job);
+    return status;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,11 +9,74 @@
 #include "header/game_aux.h"
 #include "header/game_ext.h"
 #include "header/game_tools.h"
+#include "header/game_tools_ext.h"
 
 void usage(char *nom) {
     fprintf(stderr, "Usage: %s <option> <input> [<output>]\n", nom);
     fprintf(stderr, "-s -> solve game / -c -> count solutions \n");
+    fprintf(stderr, "-p -> solve game with a portfolio of engines (the engine answering first is logged)\n");
     fprintf(stderr, "output file path not mandatory.\n");
+    fprintf(stderr, "Usage: %s -d <input> <prefix> <depth> -> split the count into the cubes <prefix>0.cube...\n", nom);
+    fprintf(stderr, "   and save their number in <prefix>.cubes\n");
+    fprintf(stderr, "Usage: %s -k <input> <cube> [<output>] -> count the solutions within a cube\n", nom);
+    fprintf(stderr, "Usage: %s -r <input> <checkpoint> [<output>] -> count solutions, saving a checkpoint every minute\n", nom);
+    fprintf(stderr, "   and resuming from it when it exists\n");
+    fprintf(stderr, "Usage: %s -m <output> <prefix> -> sum the counts saved by -k in <prefix>K.part for the cubes of -d\n", nom);
+    fprintf(stderr, "Usage: %s -a <input> <seconds> [<output>] -> estimate the number of solutions within the time given\n", nom);
+    fprintf(stderr, "--progress before the option prints the progress of a long search every second\n");
+    fprintf(stderr, "--stats <json> before -s, -p or -c saves the statistics of the solver in <json>\n");
+}
+
+// Prints the progress of the search on a single line of stderr
+void print_progress(const solver_progress *p, void *user_data) {
+    (void)user_data;
+    fprintf(stderr, "%7.1fs %12llu nodes, depth %4u, %.3g propagations/s, %5.1f%% done\n", p->seconds,
+            (unsigned long long)p->nodes, p->depth, p->propagations_per_second, 100 * p->fraction);
+}
+
+// Writes the number whose decimal logarithm is log10_nb in scientific notation (it may not fit in a double)
+void print_log10(FILE *f, double log10_nb) {
+    double exponent = floor(log10_nb);
+    fprintf(f, "%.2fe%.0f", pow(10, log10_nb - exponent), exponent);
+}
+
+// Saves the statistics of the solver as a JSON object
+void save_stats(const solver_stats *st, char *filename) {
+    FILE *save = fopen(filename, "w");
+    if (!save) {
+        fprintf(stderr, "<json> file (%s) could not be opened.\n", filename);
+        return;
+    }
+    fprintf(save, "{\n");
+    fprintf(save, "  \"decisions\": %llu,\n", (unsigned long long)st->decisions);
+    fprintf(save, "  \"propagations\": %llu,\n", (unsigned long long)st->propagations);
+    fprintf(save, "  \"conflicts\": %llu,\n", (unsigned long long)st->conflicts);
+    fprintf(save, "  \"backtracks\": %llu,\n", (unsigned long long)st->backtracks);
+    fprintf(save, "  \"rules\": {\"safe_tents\": %u, \"losing_tents\": %u, \"single_tree_tents\": %u, \"full_row_tents\": %u},\n",
+            st->safe_tents, st->losing_tents, st->single_tree_tents, st->full_row_tents);
+    fprintf(save, "  \"seconds\": {\"place_all_tents\": %.6f, \"propagation\": %.6f, \"search\": %.6f, \"verification\": %.6f},\n",
+            st->place_seconds, st->propagation_seconds, st->search_seconds, st->verification_seconds);
+    fprintf(save, "  \"verified\": %s,\n", st->verified ? "true" : "false");
+    fprintf(save, "  \"peak_memory\": %llu,\n", (unsigned long long)st->peak_memory);
+    fprintf(save, "  \"checkpoint_failures\": %u\n", st->checkpoint_failures);
+    fprintf(save, "}\n");
+    fclose(save);
+}
+
+// Saves a count in the output file. Returns false, after saying so, if it couldn't be written.
+bool save_count(unsigned long long nb, char *filename) {
+    FILE *save = fopen(filename, "w");
+    if (!save) {
+        fprintf(stderr, "<output> file (%s) could not be opened.\n", filename);
+        return false;
+    }
+    fprintf(save, "%llu\n", nb);
+    bool ok = !ferror(save);
+    if (fclose(save) != 0 || !ok) {
+        fprintf(stderr, "<output> file (%s) could not be written.\n", filename);
+        return false;
+    }
+    return true;
 }
 
 // Checks if the input file exists
@@ -21,15 +85,79 @@ bool file_exists(char *filename) {
     return (stat(filename, &buffer) == 0);
 }
 
+// Sums the counts saved by -k in <prefix>K.part for the cubes saved by -d, whose number is in <prefix>.cubes (a
+// missing count means that the cube has to be counted again)
+int merge(char *prefix, char *output) {
+    char *filename = malloc(strlen(prefix) + 16);
+    assert(filename);
+    sprintf(filename, "%s.cubes", prefix);
+    FILE *cubes = fopen(filename, "r");
+    uint nb_cubes = 0;
+    bool complete = cubes != NULL && fscanf(cubes, "%u", &nb_cubes) == 1;
+    if (cubes)
+        fclose(cubes);
+    if (!complete) {
+        fprintf(stderr, "<cubes> file (%s) is missing or invalid.\n", filename);
+        free(filename);
+        return EXIT_FAILURE;
+    }
+    unsigned long long total = 0;
+    for (uint k = 0; k < nb_cubes; k++) {
+        sprintf(filename, "%s%u.part", prefix, k);
+        FILE *partial = fopen(filename, "r");
+        unsigned long long nb = 0;
+        if (!partial || fscanf(partial, "%llu", &nb) != 1) {
+            fprintf(stderr, "<partial> file (%s) is missing or invalid.\n", filename);
+            complete = false;
+        }
+        if (partial)
+            fclose(partial);
+        if (total + nb < total) {
+            fprintf(stderr, "The sum of the counts doesn't fit in 64 bits.\n");
+            complete = false;
+        }
+        total += nb;
+    }
+    free(filename);
+    if (!complete || !save_count(total, output))
+        return EXIT_FAILURE;
+    printf("There is/are %llu solution(s) to this game.\n", total);
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
+    bool progress = false;
+    char *stats_file = NULL;
+    while (argc >= 2 && strncmp(argv[1], "--", 2) == 0) {  // Drops the flags, keeping the name of the program first
+        if (strcmp(argv[1], "--stats") == 0 && argc >= 3) {
+            stats_file = argv[2];
+            argv[2] = argv[0];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--progress") == 0)
+            progress = true;
+        else {
+            fprintf(stderr, "<flag> (%s) is not valid.\n", argv[1]);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    if (argc == 4 && strcmp(argv[1], "-m") == 0)
+        return merge(argv[3], argv[2]);
+    bool cubes = argc >= 2 && (strcmp(argv[1], "-d") == 0 || strcmp(argv[1], "-k") == 0 || strcmp(argv[1], "-r") == 0 ||
+                               strcmp(argv[1], "-a") == 0);
+
     // Cas d'erreur sur le nombre d'arguments
-    if (argc > 4 || argc < 3) {
+    if (argc > 4 + cubes || argc < 3 + cubes || (argc == 4 && strcmp(argv[1], "-d") == 0)) {
         usage(argv[0]);
         return EXIT_FAILURE;
     }
 
     // Cas d'erreur sur l'option
-    if (!(strcmp(argv[1], "-s") == 0 || strcmp(argv[1], "-c") == 0)) {
+    if (!(strcmp(argv[1], "-s") == 0 || strcmp(argv[1], "-c") == 0 || strcmp(argv[1], "-p") == 0 || cubes)) {
         fprintf(stderr, "<option> (%s) is not valid.\n", argv[1]);
         usage(argv[0]);
         return EXIT_FAILURE;
@@ -44,10 +172,23 @@ int main(int argc, char *argv[]) {
 
     // Traitement en fonction des deux options
     game c_game = game_load(argv[2]);
+    solver_options opts = solver_default_options();
+    if (progress)
+        opts.progress = print_progress;
+    solver_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (stats_file != NULL)
+        opts.stats = &stats;
 
-    if (strcmp(argv[1], "-s") == 0) {
+    if (strcmp(argv[1], "-s") == 0 || strcmp(argv[1], "-p") == 0) {
         printf("Game loaded from command line : %s\n", argv[2]);
-        bool is_game_solved = game_solve(c_game);
+        if (strcmp(argv[1], "-p") == 0) {
+            opts.backend = SOLVER_BACKEND_PORTFOLIO;
+            opts.verbose = true;
+        }
+        bool is_game_solved = game_solve_ext(c_game, &opts);
+        if (stats_file != NULL)
+            save_stats(&stats, stats_file);
         if (is_game_solved) {
             if (argc == 4) {
                 game_save(c_game, argv[3]);
@@ -62,16 +203,100 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (strcmp(argv[1], "-d") == 0) {
+        uint nb_cubes = 0;
+        bool saved = game_save_cubes(c_game, atoi(argv[4]), argv[3], &opts, &nb_cubes);
+        game_delete(c_game);
+        if (!saved) {
+            fprintf(stderr, "<cube> files (%s*) could not be written (%u saved).\n", argv[3], nb_cubes);
+            return EXIT_FAILURE;
+        }
+        printf("%u cube(s) saved in %s*.cube\n", nb_cubes, argv[3]);
+        return EXIT_SUCCESS;
+    }
+
+    if (strcmp(argv[1], "-k") == 0) {
+        uint64_t nb_sol = 0;
+        if (!game_nb_solutions_cube(c_game, argv[3], &opts, &nb_sol)) {
+            fprintf(stderr, "<cube> file (%s) can't be read or wasn't made for this game.\n", argv[3]);
+            game_delete(c_game);
+            return EXIT_FAILURE;
+        }
+        unsigned long long solutions = nb_sol;
+        game_delete(c_game);
+        if (argc == 5) {
+            if (!save_count(solutions, argv[4]))
+                return EXIT_FAILURE;
+            printf("Saved in %s", argv[4]);
+        } else
+            printf("There is/are %llu solution(s) within this cube.\n", solutions);
+        return EXIT_SUCCESS;
+    }
+
+    if (strcmp(argv[1], "-r") == 0) {
+        opts.checkpoint = argv[3];
+        opts.resume = true;
+        opts.stats = &stats;
+        unsigned long long solutions = game_nb_solutions_ext(c_game, &opts);
+        game_delete(c_game);
+        bool saved = true;
+        if (argc == 5) {
+            saved = save_count(solutions, argv[4]);
+            if (saved)
+                printf("Saved in %s", argv[4]);
+        } else
+            printf("There is/are %llu solution(s) to this game.\n", solutions);
+        if (stats.checkpoint_failures > 0) {
+            fprintf(stderr, "%u checkpoint(s) could not be written in %s.\n", stats.checkpoint_failures, argv[3]);
+            return EXIT_FAILURE;
+        }
+        return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "-a") == 0) {
+        solution_estimate e = game_nb_solutions_approx(c_game, 0.1, 0.05, atof(argv[3]), &opts);
+        game_delete(c_game);
+        FILE *out = argc == 5 ? fopen(argv[4], "w") : stdout;
+        if (!out) {
+            fprintf(stderr, "<output> file (%s) could not be opened.\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+        if (!e.found)
+            fprintf(out, "No solution found to this game.\n");
+        else {
+            fprintf(out, "There are about ");
+            print_log10(out, e.log10_nb);
+            fprintf(out, " solution(s) to this game (between ");
+            print_log10(out, e.log10_low);
+            fprintf(out, " and ");
+            print_log10(out, e.log10_high);
+            fprintf(out, " with 95%% confidence, %u probe(s)%s).\n", e.nb_probes,
+                    e.converged ? "" : ", time up before a precision of 10%");
+        }
+        if (argc == 5) {
+            bool ok = !ferror(out);
+            if (fclose(out) != 0 || !ok) {
+                fprintf(stderr, "<output> file (%s) could not be written.\n", argv[4]);
+                return EXIT_FAILURE;
+            }
+            printf("Saved in %s", argv[4]);
+        }
+        return EXIT_SUCCESS;
+    }
+
     if (strcmp(argv[1], "-c") == 0) {
-        uint solutions = game_nb_solutions(c_game);
+        char *solutions = game_nb_solutions_exact(c_game, &opts);
+        if (stats_file != NULL)
+            save_stats(&stats, stats_file);
         if (argc == 4) {
             assert(argv[3]);
             FILE *save = fopen(argv[3], "w");
-            fprintf(save, "%u\n", solutions);
+            fprintf(save, "%s\n", solutions);
             fclose(save);
             printf("Saved in %s", argv[3]);
         } else
-            printf("There is/are %u solution(s) to this game.\n", solutions);
+            printf("There is/are %s solution(s) to this game.\n", solutions);
+        free(solutions);
         game_delete(c_game);
         return EXIT_SUCCESS;
     }
@@ -1,13 +1,19 @@
 #include "header/game.h"
 
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "header/game_aux.h"
 #include "header/game_ext.h"
 #include "header/game_tools.h"
+#include "header/game_tools_ext.h"
+#include "header/solver.h"
 
 typedef struct coor {
     uint row, col;
@@ -1284,6 +1290,911 @@ bool test_nb_sol() {
     return true;
 }
 
+bool test_nb_sol_1() {
+    // Two trees share a tent in one of the solutions: rule 4 doesn't ask for one tent per tree
+    game g = game_load("../data/test.tnt");
+    if (game_nb_solutions(g) != 2)
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_20x20.tnt");
+    if (game_nb_solutions(g) != 1)
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_ext() {
+    solver_options opts = solver_default_options();
+    opts.probing = true;
+
+    game g = game_load("../data/game_25x25.tnt");
+    if (game_nb_solutions_ext(g, &opts) != 6)
+        return false;
+    opts.probe_budget = 10;
+    if (game_nb_solutions_ext(g, &opts) != 6)
+        return false;
+    if (!game_solve_ext(g, &opts) || !game_is_over(g))
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_learning() {
+    solver_options opts = solver_default_options();
+    char *files[] = {"../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_8x8_n4.tnt", "../data/game_25x25.tnt"};
+    uint expected[] = {2, 4, 4, 6};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        opts.learning = true;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.learning = false;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        game_delete(g);
+    }
+
+    game g = game_load("../data/game_100_100.tnt");
+    opts.learning = true;
+    if (!game_solve_ext(g, &opts) || !game_is_over(g))
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_sat() {
+    solver_options opts = solver_default_options();
+    opts.backend = SOLVER_BACKEND_SAT;
+    char *files[] = {"../data/test.tnt", "../data/game_3x3wd.tnt", "../data/game_nb_sol4.tnt", "../data/game_25x25.tnt"};
+    uint expected[] = {2, 1, 4, 6};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        game_delete(g);
+    }
+
+    game g = game_load("../data/game_100_100.tnt");
+    if (!game_solve_ext(g, &opts) || !game_is_over(g))
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_dlx() {
+    solver_options opts = solver_default_options();
+    solver_options dlx = solver_default_options();
+    dlx.backend = SOLVER_BACKEND_DLX;
+    char *files[] = {"../data/game_nb_sol4.tnt", "../data/game_8x8_n4.tnt", "../data/test.tnt", "../data/game_25x25.tnt"};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        uint64_t nb = game_nb_solutions_ext(g, &opts);
+        if (nb == 0 || game_nb_solutions_ext(g, &dlx) != nb)
+            return false;
+        if (!game_solve_ext(g, &dlx) || !game_is_over(g))
+            return false;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_nb_sol_components() {
+    solver_options opts = solver_default_options();
+    char *files[] = {"../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_8x8_n4.tnt", "../data/game_blocks.tnt"};
+    uint expected[] = {2, 4, 4, 64};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        opts.components = true;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.components = false;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_nb_sol_caching() {
+    solver_options opts = solver_default_options();
+    char *files[] = {"../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_25x25.tnt", "../data/game_blocks.tnt"};
+    uint expected[] = {2, 4, 6, 64};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        opts.caching = true;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.probing = true;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.probing = false;
+        opts.caching = false;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_nb_sol_dp() {
+    solver_options opts = solver_default_options();
+    char *files[] = {"../data/game_nb_sol4.tnt", "../data/game_8x8_n4.tnt", "../data/game_3x3w.tnt", "../data/test.tnt"};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        opts.dp_width = 0;
+        uint64_t nb = game_nb_solutions_ext(g, &opts);
+        opts.dp_width = 16;
+        if (nb == 0 || game_nb_solutions_ext(g, &opts) != nb)
+            return false;
+        game_delete(g);
+    }
+
+    game g = game_load("../data/game_6x60.tnt");
+    opts.dp_width = 8;
+    if (game_nb_solutions_ext(g, &opts) != 64679752296ULL)  // More than 2^32: must not be truncated on the way
+        return false;
+    if (game_nb_solutions(g) != UINT_MAX)  // Saturated by the 32 bit interface
+        return false;
+    game_delete(g);
+
+    // Long board made of independent 2x4 tiles with 2 solutions each: counted without the Steps 3 and 4, whose time
+    // grows much faster than the length
+    uint length = 20000;
+    g = game_new_empty_ext(2, length, false, false);
+    for (uint j = 0; j < length; j++) {
+        game_set_expected_nb_tents_col(g, j, j % 2 == 0);
+        if (j % 4 == 1) {
+            game_set_square(g, 0, j, TREE);
+            game_set_square(g, 1, j, TREE);
+        }
+    }
+    game_set_expected_nb_tents_row(g, 0, length / 4);
+    game_set_expected_nb_tents_row(g, 1, length / 4);
+    opts.modulus = 1000000007;
+    uint64_t expected = 1;
+    for (uint k = 0; k < length / 4; k++)
+        expected = expected * 2 % opts.modulus;
+    double start = solver_now();
+    if (game_nb_solutions_ext(g, &opts) != expected || solver_now() - start > 5)
+        return false;
+    opts.modulus = 0;
+    if (game_nb_solutions_ext(g, &opts) != UINT64_MAX)  // 2^5000
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_patterns() {
+    solver_options opts = solver_default_options();
+    opts.line_patterns = true;
+    opts.dp_width = 0;
+    char *files[] = {"../data/test.tnt", "../data/game_3x3w.tnt", "../data/game_8x8_n4.tnt", "../data/random_20_20.tnt"};
+    uint expected[] = {2, 1, 4, 4};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        if (!game_solve_ext(g, &opts) || !game_is_over(g))
+            return false;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_nb_sol_threads() {
+    solver_options opts = solver_default_options();
+    opts.nb_threads = 4;
+    char *files[] = {"../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_25x25.tnt", "../data/game_blocks.tnt"};
+    uint expected[] = {2, 4, 6, 64};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        opts.dp_width = 0;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.components = false;
+        if (game_nb_solutions_ext(g, &opts) != expected[k])
+            return false;
+        opts.components = true;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_solve_threads() {
+    solver_options opts = solver_default_options();
+    opts.nb_threads = 4;
+    char *files[] = {"../data/test.tnt", "../data/game_25x25.tnt", "../data/game_30_30.tnt", "../data/game_100_100.tnt"};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        if (!game_solve_ext(g, &opts) || !game_is_over(g))
+            return false;
+        game_delete(g);
+    }
+
+    return true;
+}
+
+bool test_solve_portfolio() {
+    solver_options opts = solver_default_options();
+    opts.backend = SOLVER_BACKEND_PORTFOLIO;
+    char *files[] = {"../data/test.tnt", "../data/game_25x25.tnt", "../data/game_30_30wd.tnt", "../data/game_100_100.tnt"};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        if (!game_solve_ext(g, &opts) || !game_is_over(g))
+            return false;
+        game_delete(g);
+    }
+
+    game g = game_load("../data/game_nb_sol4.tnt");  // Counted with the native search
+    if (game_nb_solutions_ext(g, &opts) != 4)
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_cubes() {
+    solver_options opts = solver_default_options();
+    char *files[] = {"../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_25x25.tnt", "../data/game_blocks.tnt"};
+    uint expected[] = {2, 4, 6, 64};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        uint nb_cubes = 0, nb_saved = 0;
+        if (!game_save_cubes(g, 4, "test_cube_", &opts, &nb_cubes))
+            return false;
+        FILE *load = fopen("test_cube_.cubes", "r");
+        if (!load || fscanf(load, "%u", &nb_saved) != 1 || nb_saved != nb_cubes)
+            return false;
+        fclose(load);
+        uint64_t nb_sol = 0, nb_cube = 0;
+        for (uint c = 0; c < nb_cubes; c++) {
+            char filename[32];
+            sprintf(filename, "test_cube_%u.cube", c);
+            if (!game_nb_solutions_cube(g, filename, &opts, &nb_cube))
+                return false;
+            nb_sol += nb_cube;
+            remove(filename);
+        }
+        if (nb_cubes == 0 || nb_sol != expected[k])
+            return false;
+        game_delete(g);
+    }
+
+    // Cubes of another game of the same size are reported instead of counted
+    game g = game_load("../data/game_blocks.tnt");
+    uint nb_cubes = 0;
+    if (!game_save_cubes(g, 4, "test_cube_", &opts, &nb_cubes))
+        return false;
+    game_set_expected_nb_tents_row(g, 0, game_get_expected_nb_tents_row(g, 0) + 1);
+    uint64_t nb_sol = 42;
+    for (uint c = 0; c < nb_cubes; c++) {
+        char filename[32];
+        sprintf(filename, "test_cube_%u.cube", c);
+        if (game_nb_solutions_cube(g, filename, &opts, &nb_sol))
+            return false;
+        remove(filename);
+    }
+    game_delete(g);
+
+    // A cube that can't be written fails the split, and leaves no count of the cubes
+    g = game_load("../data/test.tnt");
+    if (game_save_cubes(g, 4, "test_cube_missing/", &opts, &nb_cubes) || nb_cubes != 0)
+        return false;
+    if (fopen("test_cube_missing/.cubes", "r") != NULL)
+        return false;
+
+    // Missing, truncated and malformed cubes are reported instead of counted
+    if (game_nb_solutions_cube(g, "test_cube_missing.cube", &opts, &nb_sol))
+        return false;
+    if (!game_save_cubes(g, 0, "test_cube_", &opts, &nb_cubes) || nb_cubes != 1)
+        return false;
+    unsigned long long hash = 0;
+    FILE *load = fopen("test_cube_0.cube", "r");
+    if (!load || fscanf(load, "%*u %*u %llu", &hash) != 1)
+        return false;
+    fclose(load);
+    remove("test_cube_0.cube");
+    remove("test_cube_.cubes");
+    char contents[6][64];
+    sprintf(contents[0], "%s", "");
+    sprintf(contents[1], "12 12 %llu", hash);
+    sprintf(contents[2], "12 12 %llu 2\n0 0 *\n", hash);
+    sprintf(contents[3], "12 12 %llu 1\n12 0 *\n", hash);
+    sprintf(contents[4], "12 12 %llu 1\n0 0 x\n", hash);
+    sprintf(contents[5], "3 3 %llu 0\n", hash);
+    for (uint k = 0; k < 6; k++) {
+        FILE *save = fopen("test_cube_bad.cube", "w");
+        fputs(contents[k], save);
+        fclose(save);
+        if (game_nb_solutions_cube(g, "test_cube_bad.cube", &opts, &nb_sol))
+            return false;
+    }
+    remove("test_cube_bad.cube");
+    game_delete(g);
+    return nb_sol == 42;
+}
+
+bool test_nb_sol_checkpoint() {
+    solver_options opts = solver_default_options();
+    opts.dp_width = 0;
+    opts.checkpoint = "test_checkpoint.ckpt";
+    opts.checkpoint_period = 0;  // After every part of the search
+    remove(opts.checkpoint);
+    game g = game_load("../data/game_blocks.tnt");
+    if (game_nb_solutions_ext(g, &opts) != 64)
+        return false;
+
+    // The final checkpoint holds the count: a resumed count only reads it
+    FILE *f = fopen(opts.checkpoint, "r");
+    uint nb_rows, nb_cols, nb_left;
+    unsigned long long hash, nb_sol;
+    if (!f || fscanf(f, "%u %u %llu %llu %u", &nb_rows, &nb_cols, &hash, &nb_sol, &nb_left) != 5)
+        return false;
+    fclose(f);
+    if (nb_sol != 64 || nb_left != 0)
+        return false;
+    f = fopen(opts.checkpoint, "w");
+    fprintf(f, "%u %u %llu %llu %u\n", nb_rows, nb_cols, hash, 1000ULL, 0);
+    fclose(f);
+    opts.resume = true;
+    if (game_nb_solutions_ext(g, &opts) != 1000)
+        return false;
+    opts.resume = false;
+    if (game_nb_solutions_ext(g, &opts) != 64)
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_nb_sol4.tnt");  // Checkpoint of another game: not resumed
+    opts.resume = true;
+    if (game_nb_solutions_ext(g, &opts) != 4)
+        return false;
+    remove(opts.checkpoint);
+
+    // A checkpoint that can't be written is reported, and the count goes on
+    solver_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    opts.stats = &stats;
+    opts.checkpoint = "test_no_directory/test_checkpoint.ckpt";
+    if (game_nb_solutions_ext(g, &opts) != 4 || stats.checkpoint_failures == 0)
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_big() {
+    solver_options opts = solver_default_options();
+    game g = game_load("../data/game_132x132_units.tnt");  // 22 independent units with 8 solutions each
+    if (game_nb_solutions_ext(g, &opts) != UINT64_MAX || game_nb_solutions(g) != UINT_MAX)
+        return false;
+    char *exact = game_nb_solutions_exact(g, &opts);
+    bool ok = strcmp(exact, "73786976294838206464") == 0;  // 8^22 = 2^66
+    free(exact);
+    opts.modulus = 1000003;
+    ok = ok && game_nb_solutions_ext(g, &opts) == 402745;
+    game_delete(g);
+
+    g = game_load("../data/game_6x60.tnt");  // Counted by the DP
+    ok = ok && game_nb_solutions_ext(g, &opts) == 64679752296ULL % 1000003;
+    opts.modulus = 0;
+    exact = game_nb_solutions_exact(g, &opts);
+    ok = ok && strcmp(exact, "64679752296") == 0;
+    free(exact);
+    game_delete(g);
+
+    return ok;
+}
+
+bool test_count_capped() {
+    char *files[] = {"../data/game_30_30.tnt", "../data/test.tnt", "../data/game_nb_sol4.tnt", "../data/game_blocks.tnt"};
+    uint expected[] = {1, 2, 4, 64};
+
+    for (uint k = 0; k < 4; k++) {
+        game g = game_load(files[k]);
+        for (uint limit = 1; limit <= 8; limit++)
+            if (game_solution_count_capped(g, limit) != (expected[k] < limit ? expected[k] : limit))
+                return false;
+        if (game_has_unique_solution(g) != (expected[k] == 1))
+            return false;
+        game_delete(g);
+    }
+
+    // A tree without any square for its tent
+    square squares[] = {TREE, EMPTY, EMPTY, EMPTY};
+    uint nb_tents[] = {0, 0};
+    game g = game_new_ext(2, 2, squares, nb_tents, nb_tents, false, false);
+    if (game_solution_count_capped(g, 2) != 0 || game_has_unique_solution(g))
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+typedef struct solutions {
+    game g;
+    unsigned char seen[8][8];  // Bitmaps received (the game has at most 8 x 8 squares)
+    uint nb, stop_after;
+    bool ok;
+} solutions;
+
+// Checks that the bitmap is a new solution of the game
+static bool keep_solution(const unsigned char *tents, void *user_data) {
+    solutions *sol = user_data;
+    uint nb_cols = game_nb_cols(sol->g), nb_bytes = (game_nb_rows(sol->g) * nb_cols + 7) / 8;
+    game c = game_copy(sol->g);
+    for (uint i = 0; i < game_nb_rows(c); i++)
+        for (uint j = 0; j < nb_cols; j++)
+            if (game_get_square(c, i, j) != TREE) {
+                uint k = i * nb_cols + j;
+                game_set_square(c, i, j, (tents[k / 8] >> (k % 8)) & 1 ? TENT : EMPTY);
+            }
+    sol->ok &= game_is_over(c) && sol->nb < 8;
+    for (uint k = 0; k < sol->nb && sol->ok; k++)
+        sol->ok &= memcmp(sol->seen[k], tents, nb_bytes) != 0;
+    if (sol->ok)
+        memcpy(sol->seen[sol->nb], tents, nb_bytes);
+    sol->nb++;
+    game_delete(c);
+    return sol->nb != sol->stop_after;
+}
+
+bool test_enumerate_solutions() {
+    game g = game_load("../data/game_nb_sol4.tnt");
+    solutions sol = {g, {{0}}, 0, 0, true};
+    if (game_enumerate_solutions(g, keep_solution, &sol, 0) != 4 || sol.nb != 4 || !sol.ok)
+        return false;
+
+    sol.nb = 0;
+    if (game_enumerate_solutions(g, keep_solution, &sol, 3) != 3 || sol.nb != 3 || !sol.ok)
+        return false;
+
+    sol.nb = 0;
+    sol.stop_after = 2;  // Stopped by the callback
+    if (game_enumerate_solutions(g, keep_solution, &sol, 0) != 2 || sol.nb != 2 || !sol.ok)
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+bool test_sample_solution() {
+    game g = game_load("../data/game_nb_sol4.tnt");
+    solutions sol = {g, {{0}}, 0, 0, true};
+    game_enumerate_solutions(g, keep_solution, &sol, 0);
+    uint nb_cols = game_nb_cols(g), nb_bytes = (game_nb_rows(g) * nb_cols + 7) / 8;
+
+    uint64_t rng = 42;
+    uint drawn[4] = {0};
+    for (uint n = 0; n < 400; n++) {  // Each of the 4 solutions is expected about 100 times
+        game c = game_copy(g);
+        if (!game_sample_solution(c, &rng) || !game_is_over(c))
+            return false;
+        unsigned char tents[8] = {0};
+        for (uint k = 0; k < game_nb_rows(c) * nb_cols; k++)
+            if (game_get_square(c, k / nb_cols, k % nb_cols) == TENT)
+                tents[k / 8] |= 1 << (k % 8);
+        uint s = 0;
+        while (s < 4 && memcmp(sol.seen[s], tents, nb_bytes) != 0)
+            s++;
+        if (s == 4)
+            return false;
+        drawn[s]++;
+        game_delete(c);
+    }
+    for (uint s = 0; s < 4; s++)
+        if (drawn[s] < 60 || drawn[s] > 140)
+            return false;
+
+    game a = game_copy(g), b = game_copy(g);  // The same state draws the same solution
+    uint64_t rng_a = 7, rng_b = 7;
+    if (!game_sample_solution(a, &rng_a) || !game_sample_solution(b, &rng_b) || !game_equal(a, b))
+        return false;
+    game_delete(a);
+    game_delete(b);
+
+    game_set_expected_nb_tents_row(g, 0, game_get_expected_nb_tents_row(g, 0) + 1);  // No solution left
+    game c = game_copy(g);
+    if (game_sample_solution(g, &rng) || !game_equal(g, c))
+        return false;
+    game_delete(c);
+    game_delete(g);
+
+    return true;
+}
+
+bool test_nb_sol_approx() {
+    solver_options opts = solver_default_options();
+    game g = game_load("../data/game_132x132_units.tnt");  // 2^66 solutions, every tree on its own
+    solution_estimate e = game_nb_solutions_approx(g, 0.1, 0.05, 60, &opts);
+    if (!e.found || !e.converged || fabs(e.log10_nb - 66 * log10(2)) > 1e-6 || e.log10_low != e.log10_high)
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_6x60.tnt");  // Counted exactly by dynamic programming
+    e = game_nb_solutions_approx(g, 0.1, 0.05, 60, &opts);
+    if (!e.found || e.nb_probes != 0 || fabs(e.log10_nb - log10(64679752296.0)) > 1e-6)
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_25x25.tnt");  // 6 solutions, every probe finds them all with probing
+    opts.probing = true;
+    e = game_nb_solutions_approx(g, 0.1, 0.05, 60, &opts);
+    if (!e.found || !e.converged || e.nb_probes == 0 || fabs(e.log10_nb - log10(6)) > 1e-6)
+        return false;
+
+    game_set_expected_nb_tents_row(g, 0, game_get_expected_nb_tents_row(g, 0) + 1);  // No solution left
+    e = game_nb_solutions_approx(g, 0.1, 0.05, 1, &opts);
+    if (e.found)
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_8x8_n4.tnt");  // The same seed gives the same probes
+    opts.probing = false;
+    opts.dp_width = 0;
+    opts.seed = 12345;
+    e = game_nb_solutions_approx(g, 0.1, 0.05, 60, &opts);
+    solution_estimate again = game_nb_solutions_approx(g, 0.1, 0.05, 60, &opts);
+    if (!e.found || !e.converged || again.nb_probes != e.nb_probes || again.log10_nb != e.log10_nb)
+        return false;
+    game_delete(g);
+
+    return true;
+}
+
+typedef struct partial {
+    game deduced;
+    bool ok;
+} partial;
+
+// Checks that the tents and the grass deduced agree with the solution
+static bool agrees(const unsigned char *tents, void *user_data) {
+    partial *p = user_data;
+    uint nb_cols = game_nb_cols(p->deduced);
+    for (uint i = 0; i < game_nb_rows(p->deduced); i++)
+        for (uint j = 0; j < nb_cols; j++) {
+            uint k = i * nb_cols + j;
+            bool tent = (tents[k / 8] >> (k % 8)) & 1;
+            square s = game_get_square(p->deduced, i, j);
+            p->ok &= !(s == TENT && !tent) && !(s == GRASS && tent);
+        }
+    return true;
+}
+
+bool test_solve_budget() {
+    solver_options opts = solver_default_options();
+    game g = game_load("../data/game_default.tnt");
+    if (game_solve_budget(g, &opts) != SOLVE_SOLVED || !game_is_over(g))
+        return false;
+    game_delete(g);
+
+    g = game_load("../data/game_25x25.tnt");  // 6 solutions: the first decision is out of budget
+    game c = game_copy(g);
+    opts.max_nodes = 1;
+    if (game_solve_budget(c, &opts) != SOLVE_LIMIT || game_is_over(c))
+        return false;
+    partial p = {c, true};
+    if (game_enumerate_solutions(g, agrees, &p, 0) != 6 || !p.ok)
+        return false;
+    game_delete(c);
+    opts.max_nodes = 0;
+    opts.max_memory = 1;
+    c = game_copy(g);
+    if (game_solve_budget(c, &opts) != SOLVE_LIMIT)
+        return false;
+    game_delete(c);
+    opts.max_memory = 0;
+
+    game_set_expected_nb_tents_row(g, 0, game_get_expected_nb_tents_row(g, 0) + 1);  // No solution left
+    c = game_copy(g);
+    if (game_solve_budget(g, &opts) != SOLVE_UNSAT || !game_equal(g, c))
+        return false;
+    game_delete(c);
+    game_delete(g);
+
+    // The nogoods learned before the budget ran out add to the deductions of the root
+    g = game_load("../data/game_40x40_nogoods.tnt");
+    game root = game_copy(g);
+    opts.max_nodes = 1;
+    if (game_solve_budget(root, &opts) != SOLVE_LIMIT)
+        return false;
+    c = game_copy(g);
+    opts.max_nodes = 20000;
+    if (game_solve_budget(c, &opts) != SOLVE_LIMIT)
+        return false;
+    uint nb_more = 0;
+    for (uint i = 0; i < game_nb_rows(g); i++)
+        for (uint j = 0; j < game_nb_cols(g); j++) {
+            square r = game_get_square(root, i, j), s = game_get_square(c, i, j);
+            if (r != EMPTY && r != s)
+                return false;
+            nb_more += r != s;
+        }
+    if (nb_more == 0)
+        return false;
+    game_delete(root);
+    game_delete(c);
+    game_delete(g);
+    opts.max_nodes = 0;
+
+    g = game_load("../data/game_40x40_hard.tnt");  // Several seconds for the native search
+    opts.max_seconds = 0.2;
+    for (uint nb_threads = 1; nb_threads <= 4; nb_threads += 3) {
+        opts.nb_threads = nb_threads;
+        c = game_copy(g);
+        clock_t start = clock();
+        if (game_solve_budget(c, &opts) != SOLVE_TIMEOUT || game_is_over(c))
+            return false;
+        if ((double)(clock() - start) / CLOCKS_PER_SEC > 2.0 * nb_threads)  // Processor time of all the threads
+            return false;
+        game_delete(c);
+    }
+    opts.nb_threads = 1;
+
+    // The SAT backend alone stops with the same budget, its decisions being its nodes
+    opts.backend = SOLVER_BACKEND_SAT;
+    c = game_copy(g);
+    if (game_solve_budget(c, &opts) != SOLVE_TIMEOUT || game_is_over(c))
+        return false;
+    game_delete(c);
+    opts.max_seconds = 0;
+    opts.max_nodes = 1;
+    c = game_copy(g);
+    if (game_solve_budget(c, &opts) != SOLVE_LIMIT || game_is_over(c))
+        return false;
+    game_delete(c);
+    opts.max_nodes = 0;
+    opts.max_memory = 1;
+    c = game_copy(g);
+    if (game_solve_budget(c, &opts) != SOLVE_LIMIT || game_is_over(c))
+        return false;
+    game_delete(c);
+    game_delete(g);
+
+    return true;
+}
+
+// Checks every report of a search: nodes increase, and so does the fraction done when only counting
+typedef struct {
+    uint nb_reports;
+    uint64_t nodes;
+    double fraction;
+    bool monotonic, ok;
+} reports;
+
+static void check_report(const solver_progress *p, void *user_data) {
+    reports *r = user_data;
+    if (p->nodes <= r->nodes || p->fraction < 0 || p->fraction > 1 || p->seconds < 0 ||
+        p->propagations_per_second < 0 || (r->monotonic && p->fraction < r->fraction))
+        r->ok = false;
+    r->nb_reports++;
+    r->nodes = p->nodes;
+    r->fraction = p->fraction;
+}
+
+bool test_progress_report() {
+    solver_options opts = solver_default_options();
+    reports r = {0, 0, 0, false, true};
+    opts.progress = check_report;
+    opts.progress_data = &r;
+    opts.progress_period = 0;  // Every 64 decisions
+    opts.max_nodes = 4096;
+    game g = game_load("../data/game_40x40_hard.tnt");
+    if (game_solve_budget(g, &opts) != SOLVE_LIMIT || !r.ok || r.nb_reports < 4096 / 64 - 1)
+        return false;
+    game_delete(g);
+
+    opts.max_nodes = 0;
+    r = (reports){0, 0, 0, true, true};
+    g = game_load("../data/game_25x25.tnt");  // Counted by components
+    if (game_nb_solutions_ext(g, &opts) != 6 || !r.ok || r.nb_reports == 0)
+        return false;
+
+    r = (reports){0, 0, 0, false, true};
+    opts.nb_threads = 4;  // Not reported by the parallel search
+    if (!game_solve_ext(g, &opts) || r.nb_reports != 0)
+        return false;
+    game_delete(g);
+    return true;
+}
+
+bool test_solver_stats() {
+    solver_options opts = solver_default_options();
+    solver_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    opts.stats = &stats;
+    game g = game_load("../data/game_30_30.tnt");  // Solved by the rules of Step 4 alone
+    if (!game_solve_ext(g, &opts) || !stats.verified || stats.decisions != 0 || stats.peak_memory == 0)
+        return false;
+    if (stats.safe_tents + stats.losing_tents + stats.single_tree_tents + stats.full_row_tents == 0)
+        return false;
+    if (stats.place_seconds < 0 || stats.propagation_seconds < 0 || stats.search_seconds < 0 ||
+        stats.verification_seconds < 0)
+        return false;
+    game_delete(g);
+
+    memset(&stats, 0, sizeof(stats));
+    g = game_load("../data/game_25x25.tnt");  // 6 solutions left to the search
+    if (game_nb_solutions_ext(g, &opts) != 6 || stats.decisions == 0 || stats.backtracks == 0 || stats.verified)
+        return false;
+    uint64_t decisions = stats.decisions;
+    if (game_nb_solutions_ext(g, &opts) != 6 || stats.decisions != 2 * decisions)  // The counters add up
+        return false;
+    opts.nb_threads = 4;
+    if (!game_solve_ext(g, &opts) || !stats.verified)
+        return false;
+    game_delete(g);
+    return true;
+}
+
+static void count_done(game g, solve_status status, void *user_data) {
+    if (status == SOLVE_SOLVED && game_is_over(g))
+        __atomic_add_fetch((int *)user_data, 1, __ATOMIC_RELAXED);
+}
+
+bool test_solve_async() {
+    solver_options opts = solver_default_options();
+    int nb_done = 0;
+    game games[8];
+    solve_job jobs[8];
+    for (uint k = 0; k < 8; k++) {
+        games[k] = game_load(k % 2 == 0 ? "../data/game_25x25.tnt" : "../data/game_default.tnt");
+        jobs[k] = game_solve_async(games[k], &opts, count_done, &nb_done);
+    }
+    for (uint k = 0; k < 8; k++) {
+        if (game_solve_wait(jobs[k]) != SOLVE_SOLVED || !game_is_over(games[k]))
+            return false;
+        game_delete(games[k]);
+    }
+    if (nb_done != 8)
+        return false;
+
+    game g = game_load("../data/game_40x40_hard.tnt");  // Several seconds each: cancelled running or queued
+    for (uint k = 0; k < 8; k++) {
+        games[k] = game_copy(g);
+        jobs[k] = game_solve_async(games[k], &opts, count_done, &nb_done);
+    }
+    if (game_solve_poll(jobs[0]))
+        return false;
+    for (uint k = 0; k < 8; k++)
+        game_solve_cancel(jobs[k]);
+    for (uint k = 0; k < 8; k++) {
+        if (game_solve_wait(jobs[k]) != SOLVE_CANCELLED || !game_equal(games[k], g))
+            return false;
+        game_delete(games[k]);
+    }
+    game_delete(g);
+    return nb_done == 8;
+}
+
+bool test_branching() {
+    // 1 x 5 board T ? . ? T: the trees have a single candidate each, and the tie with the column of the second
+    // candidate goes to the first tree
+    square squares[] = {TREE, EMPTY, EMPTY, EMPTY, TREE};
+    square tents[] = {TREE, TENT, EMPTY, TENT, TREE};
+    uint row[] = {2}, col[] = {0, 1, 0, 1, 0};
+    game g = game_new_ext(1, 5, squares, row, col, false, false);
+    game gc = game_new_ext(1, 5, tents, row, col, false, false);
+    solver s = solver_new(g, gc);
+    bool ok = solver_choose_mrv(s) == 1 && solver_choose_first(s) == 1;
+    solver_delete(s);
+    game_set_expected_nb_tents_col(g, 3, 2);  // The column can't hold its tents: it comes first
+    s = solver_new(g, gc);
+    ok = ok && solver_choose_mrv(s) == 3 && solver_choose_first(s) == 1;
+    solver_delete(s);
+    game_delete(g);
+    game_delete(gc);
+    if (!ok)
+        return false;
+
+    // Both heuristics find the same solutions
+    char *files[] = {"../data/game_default.tnt", "../data/game_20x20.tnt", "../data/game_25x25.tnt",
+                     "../data/random_20_20.tnt", "../data/random_30_30.tnt", "../data/game_3x3w.tnt",
+                     "../data/game_3x3wd.tnt", "../data/game_8x8_n4.tnt", "../data/game_blocks.tnt"};
+    for (uint f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+        game games[2];
+        uint64_t counts[2];
+        for (uint h = 0; h < 2; h++) {
+            solver_options opts = solver_default_options();
+            opts.branching = h == 0 ? SOLVER_BRANCHING_MRV : SOLVER_BRANCHING_FIRST;
+            games[h] = game_load(files[f]);
+            counts[h] = game_nb_solutions_ext(games[h], &opts);
+            opts.components = false;  // Counted by the depth-first search too
+            if (game_nb_solutions_ext(games[h], &opts) != counts[h] || !game_solve_ext(games[h], &opts) ||
+                !game_is_over(games[h]))
+                return false;
+        }
+        if (counts[0] != counts[1] || counts[0] == 0 || (counts[0] == 1 && !game_equal(games[0], games[1])))
+            return false;
+        game_delete(games[0]);
+        game_delete(games[1]);
+    }
+    return true;
+}
+
+// A game shared by several threads, with the answers of the queries computed beforehand by a single thread
+typedef struct shared_game {
+    cgame g;
+    int *moves;  // game_check_move(g, i, j, s) at (i * nb_cols + j) * 4 + s
+    bool over;
+    uint64_t nb_sol;
+    int failed;  // Set (atomically) by a thread getting another answer
+} shared_game;
+
+static void *query_shared_game(void *arg) {
+    shared_game *sh = arg;
+    uint nb_rows = game_nb_rows(sh->g), nb_cols = game_nb_cols(sh->g);
+    bool ok = true;
+    for (uint round = 0; round < 4 && ok; round++) {
+        for (uint i = 0; i < nb_rows; i++)
+            for (uint j = 0; j < nb_cols; j++)
+                for (square s = EMPTY; s <= GRASS; s++)
+                    ok = ok && game_check_move(sh->g, i, j, s) == sh->moves[(i * nb_cols + j) * 4 + s];
+        uint tents = 0;
+        for (uint i = 0; i < nb_rows; i++)
+            tents += game_get_current_nb_tents_row(sh->g, i);
+        ok = ok && tents == game_get_current_nb_tents_all(sh->g) && game_is_over(sh->g) == sh->over;
+    }
+    game copy = game_copy(sh->g);  // The solvers work on a copy of the shared game
+    solver_options opts = solver_default_options();
+    ok = ok && game_nb_solutions_ext(copy, &opts) == sh->nb_sol && game_solve(copy) && game_is_over(copy);
+    game_delete(copy);
+    if (!ok)
+        __atomic_store_n(&sh->failed, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+bool test_concurrent_queries() {
+    game g = game_load("../data/game_25x25.tnt");
+    game_solve(g);
+    for (uint i = 0; i < game_nb_rows(g); i += 2)  // Some tents are left, so that moves are REGULAR or LOSING
+        for (uint j = 0; j < game_nb_cols(g); j++)
+            if (game_get_square(g, i, j) == TENT)
+                game_set_square(g, i, j, EMPTY);
+    uint nb_rows = game_nb_rows(g), nb_cols = game_nb_cols(g);
+    shared_game sh = {g, malloc(nb_rows * nb_cols * 4 * sizeof(int)), game_is_over(g), 0, 0};
+    if (sh.moves == NULL)
+        return false;
+    for (uint i = 0; i < nb_rows; i++)
+        for (uint j = 0; j < nb_cols; j++)
+            for (square s = EMPTY; s <= GRASS; s++)
+                sh.moves[(i * nb_cols + j) * 4 + s] = game_check_move(g, i, j, s);
+    game copy = game_copy(g);
+    solver_options opts = solver_default_options();
+    sh.nb_sol = game_nb_solutions_ext(copy, &opts);
+    game_delete(copy);
+
+    pthread_t threads[8];
+    for (uint t = 0; t < 8; t++)
+        pthread_create(&threads[t], NULL, query_shared_game, &sh);
+    for (uint t = 0; t < 8; t++)
+        pthread_join(threads[t], NULL);
+    free(sh.moves);
+    game_delete(g);
+    return !sh.failed && sh.nb_sol > 0;
+}
+
 int main(int argc, char *argv[]) {
     if (argc == 2) {
         char *arg = argv[1];
@@ -1395,6 +2306,56 @@ int main(int argc, char *argv[]) {
             ok = test_solve();
         else if (strcmp("nb_sol", arg) == 0)
             ok = test_nb_sol();
+        else if (strcmp("nb_sol_1", arg) == 0)
+            ok = test_nb_sol_1();
+        else if (strcmp("nb_sol_ext", arg) == 0)
+            ok = test_nb_sol_ext();
+        else if (strcmp("nb_sol_learning", arg) == 0)
+            ok = test_nb_sol_learning();
+        else if (strcmp("nb_sol_sat", arg) == 0)
+            ok = test_nb_sol_sat();
+        else if (strcmp("nb_sol_dlx", arg) == 0)
+            ok = test_nb_sol_dlx();
+        else if (strcmp("nb_sol_components", arg) == 0)
+            ok = test_nb_sol_components();
+        else if (strcmp("nb_sol_caching", arg) == 0)
+            ok = test_nb_sol_caching();
+        else if (strcmp("nb_sol_dp", arg) == 0)
+            ok = test_nb_sol_dp();
+        else if (strcmp("nb_sol_patterns", arg) == 0)
+            ok = test_nb_sol_patterns();
+        else if (strcmp("nb_sol_threads", arg) == 0)
+            ok = test_nb_sol_threads();
+        else if (strcmp("solve_threads", arg) == 0)
+            ok = test_solve_threads();
+        else if (strcmp("solve_portfolio", arg) == 0)
+            ok = test_solve_portfolio();
+        else if (strcmp("nb_sol_cubes", arg) == 0)
+            ok = test_nb_sol_cubes();
+        else if (strcmp("nb_sol_checkpoint", arg) == 0)
+            ok = test_nb_sol_checkpoint();
+        else if (strcmp("nb_sol_big", arg) == 0)
+            ok = test_nb_sol_big();
+        else if (strcmp("count_capped", arg) == 0)
+            ok = test_count_capped();
+        else if (strcmp("enumerate_solutions", arg) == 0)
+            ok = test_enumerate_solutions();
+        else if (strcmp("sample_solution", arg) == 0)
+            ok = test_sample_solution();
+        else if (strcmp("nb_sol_approx", arg) == 0)
+            ok = test_nb_sol_approx();
+        else if (strcmp("solve_budget", arg) == 0)
+            ok = test_solve_budget();
+        else if (strcmp("progress_report", arg) == 0)
+            ok = test_progress_report();
+        else if (strcmp("solver_stats", arg) == 0)
+            ok = test_solver_stats();
+        else if (strcmp("solve_async", arg) == 0)
+            ok = test_solve_async();
+        else if (strcmp("concurrent_queries", arg) == 0)
+            ok = test_concurrent_queries();
+        else if (strcmp("branching", arg) == 0)
+            ok = test_branching();
         else {
             fprintf(stderr, "Error: test \"%s\" not found!\n", arg);
             exit(EXIT_FAILURE);
@@ -1,16 +1,25 @@
 #include "header/game_tools.h"
 
 #include <assert.h>
+#include <limits.h>
+#include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "header/game.h"
 #include "header/game_ext.h"
+#include "header/game_tools_ext.h"
 #include "header/private.h"
+#include "header/solver.h"
 
 typedef struct game_and_nb {
     game g;
-    uint nb;
+    uint64_t nb;      // Modulo opts->modulus if it is not 0
+    bool overflow;    // The number of solutions doesn't fit in 64 bits (nb is then UINT64_MAX)
+    uint nb_unknown;  // Squares left to the search: there are at most 2^nb_unknown solutions
+    solve_status status;  // When solving: g is the solution if SOLVED, the squares deduced if TIMEOUT or LIMIT
 } game_and_nb;
 
 /* ************************************************************************** */
@@ -104,208 +113,12 @@ static game_and_nb empty_game_nb() {
     game_and_nb tmp;
     tmp.g = NULL;
     tmp.nb = 0;
+    tmp.overflow = false;
+    tmp.nb_unknown = 0;
+    tmp.status = SOLVE_UNSAT;
     return tmp;
 }
 
-/* ********************* COMBINATORIAL / SEQUENCES PART ********************* */
-
-// Get the first sequence of an (n, k) combinatorial class
-static int *firstSequence(int n, int k) {
-    int *s = calloc(k, sizeof(int));
-    assert(s);
-    for (int i = 0; i < k; i++)  // (1, 2, ..., k - 1)
-        s[i] = i;
-    return s;
-}
-
-// Get the last sequence of an (n, k) combinatorial class
-static int *lastSequence(int n, int k) {
-    int *l = calloc(k, sizeof(int));
-    assert(l);
-    for (int i = 0; i < k; i++)  // (n-1, n-2, ..., n-k+1)
-        l[k - i - 1] = n - i - 1;
-    return l;
-}
-
-// Get the next sequence of an (n, k) combinatorial class compared to s
-static int *nextOfSequence(int n, int k, int *s) {
-    assert(s);
-    int cpt = 0;
-    for (int i = 0; i < k; i++) {
-        if (s[k - i - 1] < (n - 1 - i)) {
-            s[k - i - 1] += 1;
-            cpt = k - i;
-            break;
-        }
-    }
-    for (int i = cpt; i < k; i++)
-        s[i] = s[i - 1] + 1;
-    return s;
-}
-
-// Return true if s1 and s2 sequences are equal; false otherwise
-static bool sequencesAreEqual(int *s1, int *s2, int s) {
-    assert(s1 && s2);
-    for (uint i = 0; i < s; i++)
-        if (s1[i] != s2[i])
-            return false;
-    return true;
-}
-
-static void incrementAtPos(int *s, int *l, uint pos, uint n, uint k) {
-    assert(s && l);
-    if (pos == 0)
-        return;
-    if (s[pos] == l[pos]) {
-        incrementAtPos(s, l, pos - 1, n, k);
-        return;
-    }
-    s[pos]++;
-    for (int i = pos + 1; i < k; i++) {
-        s[i] = s[i - 1] + 1;
-    }
-}
-
-/* ************************************************************************** */
-
-static bool optimise_game_is_over(cgame g) {
-    uint cpt_tent = 0;
-    uint cpt_tree = 0;
-
-    uint cpt_tent_row = 0;
-
-    for (uint i = 0; i < game_nb_rows(g); i++) {
-        for (uint j = 0; j < game_nb_cols(g); j++) {
-            if (i == 0)
-                if (nb_square_col(g, j, TENT) != game_get_expected_nb_tents_col(g, j))
-                    return false;
-
-            // Rule 1
-            if (check_square_tent(g, i, j))
-                if (neigh_get_square(g, i, j, TENT, !game_is_diagadj(g)))
-                    return false;
-
-            // Rule 3
-            if (game_get_square(g, i, j) == TENT) {
-                cpt_tent++;
-                cpt_tent_row++;
-            }
-            if (game_get_square(g, i, j) == TREE) cpt_tree++;
-
-            // Rule 4
-            if (check_square_tree(g, i, j))  // (i, j) tree get a tent on his orthogonally neighbors.
-                if (!neigh_get_square(g, i, j, TENT, false))
-                    return false;
-            if (check_square_tent(g, i, j))  // (i, j) tent get a tree on his orthogonally neighbors.
-                if (!neigh_get_square(g, i, j, TREE, false))
-                    return false;
-        }
-
-        if (cpt_tent_row != game_get_expected_nb_tents_row(g, i))
-            return false;
-        cpt_tent_row = 0;
-    }
-    return cpt_tent == cpt_tree;
-}
-
-static bool isImpossibleSequence(cgame g, coor *a, int *s, int *l, uint n, uint k) {
-    assert(s);
-    uint row = 0;
-    uint *count_row = calloc(game_nb_rows(g), sizeof(uint));
-    assert(count_row);
-
-    for (uint i = 0; i < k; i++) {
-        row = row_of_coor(a[s[i]]);
-        count_row[row]++;
-
-        if (count_row[row] > game_get_expected_nb_tents_row(g, row)) {
-            incrementAtPos(s, l, i, n, k);
-            free(count_row);
-            return false;
-        }
-
-        if (i != k - 1) {
-            if (row_of_coor(a[s[i]]) == row_of_coor(a[s[i + 1]])) {
-                if (col_of_coor(a[s[i]]) + 1 == col_of_coor(a[s[i + 1]])) {
-                    incrementAtPos(s, l, i + 1, n, k);
-                    free(count_row);
-                    return false;
-                }
-            }
-        }
-    }
-    free(count_row);
-    return false;
-}
-
-// Return one solution of the g game
-static game getOneSolution(coor *a, int n, int k, cgame g) {
-    int *s = firstSequence(n, k);
-    int *l = lastSequence(n, k);
-    game copy_game = game_copy(g);
-
-    while (s != NULL) {  // As long as there is a sequence to use
-        for (uint i = 0; i < k; i++)  // Copy all tents of the sequences
-            game_play_move(copy_game, row_of_coor(a[s[i]]), col_of_coor(a[s[i]]), TENT);
-
-        if (optimise_game_is_over(copy_game)) {  // If we've got a winning game
-            free(s);
-            free(l);
-            return copy_game;
-        }
-
-        if (sequencesAreEqual(s, l, k)) {  // If is the end of program -> we can't find solutions
-            free(s);
-            s = NULL;
-        } else {
-            do {
-                s = nextOfSequence(n, k, s);
-            } while (isImpossibleSequence(copy_game, a, s, l, n, k));
-        }
-
-        for (uint i = 0; i < k; i++)
-            game_undo(copy_game);
-    }
-    game_delete(copy_game);
-    free(s);
-    free(l);
-    return NULL;  // Return an empty game because there are no solutions
-}
-
-// Return the number of solutions of the g game
-static uint getNbrSolution(coor *a, int n, int k, cgame g) {
-    int *s = firstSequence(n, k);
-    int *l = lastSequence(n, k);
-    game copy_game = game_copy(g);
-    uint cpt = 0;
-
-    while (s != NULL) {  // As long as there is a sequence to use
-        for (uint i = 0; i < k; i++)  // Copy all tents of the sequences
-            game_play_move(copy_game, row_of_coor(a[s[i]]), col_of_coor(a[s[i]]), TENT);
-
-        if (optimise_game_is_over(copy_game))  // If we've got a winning game
-            cpt++;
-
-        if (sequencesAreEqual(s, l, k)) {  // If is the end of program -> we can't find solutions
-            free(s);
-            s = NULL;
-        } else {
-            do {
-                s = nextOfSequence(n, k, s);
-            } while (isImpossibleSequence(copy_game, a, s, l, n, k));
-        }
-
-        for (uint i = 0; i < k; i++)
-            game_undo(copy_game);
-    }
-    game_delete(copy_game);
-    free(s);
-    free(l);
-    return cpt;
-}
-
-/* ************************************************************************** */
-
 // Function linked to valid_tents_with_one_tree: validate a tent on a tree
 static void valid_unique_tent(game gc, game gs, uint i, uint j) {
     if (neigh_check_square(gc, i, j, NORTH, TENT)) {
@@ -350,43 +163,59 @@ static void remove_unnecessary_tents(game g) {
                 game_set_square(g, i, j, EMPTY);
 }
 
-// Copy of tents necessarily well placed in the game gc
-static void copy_safe_tents(game gc, game gs) {
+// Copy of tents necessarily well placed in the game gc. Returns the number of tents placed.
+static uint copy_safe_tents(game gc, game gs) {
+    uint nb = 0;
     for (uint j = 0; j < game_nb_cols(gc); j++)
         if (game_get_current_nb_tents_col(gc, j) + game_get_current_nb_tents_col(gs, j) == game_get_expected_nb_tents_col(gs, j))
             for (uint i = 0; i < game_nb_rows(gs); i++)
-                if (check_square_tent(gc, i, j))
+                if (check_square_tent(gc, i, j)) {
+                    nb += !check_square_tent(gs, i, j);
                     game_set_square(gs, i, j, TENT);
+                }
+    return nb;
 }
 
-// Delete all tents necessarily well placed in the game gs (with nb_expected)
-static void delete_tents_expected(game gc, game gs) {
+// Delete all tents necessarily well placed in the game gs (with nb_expected). Returns the number of potential tents
+// deleted (the ones not placed in gs).
+static uint delete_tents_expected(game gc, game gs) {
+    uint nb = 0;
     for (uint i = 0; i < game_nb_rows(gs); i++)
         if (game_get_expected_nb_tents_row(gs, i) == game_get_current_nb_tents_row(gs, i)) {
             for (uint j = 0; j < game_nb_cols(gs); j++)
-                if (!check_square_tree(gc, i, j))
+                if (!check_square_tree(gc, i, j)) {
+                    nb += check_square_tent(gc, i, j) && !check_square_tent(gs, i, j);
                     game_set_square(gc, i, j, EMPTY);
+                }
         }
+    return nb;
 }
 
-// If play tent on (i, j) position on gs game is LOSING, we can delete this tent
-static void remove_with_losing(game gc, cgame gs) {
+// If play tent on (i, j) position on gs game is LOSING, we can delete this tent. Returns the number of tents deleted.
+static uint remove_with_losing(game gc, cgame gs) {
+    uint nb = 0;
     for (uint i = 0; i < game_nb_rows(gc); i++)
         for (uint j = 0; j < game_nb_cols(gc); j++)
             if (check_square_tent(gc, i, j))
-                if (game_check_move(gs, i, j, TENT) == LOSING)
+                if (game_check_move(gs, i, j, TENT) == LOSING) {
                     game_set_square(gc, i, j, EMPTY);
+                    nb++;
+                }
+    return nb;
 }
 
-// If a tree get only one tent : we can valid it
-static void valid_tents_with_one_tree(game gc, game gs) {
+// If a tree get only one tent : we can valid it. Returns the number of tents validated.
+static uint valid_tents_with_one_tree(game gc, game gs) {
+    uint nb = 0;
     for (uint i = 0; i < game_nb_rows(gc); i++)
         for (uint j = 0; j < game_nb_cols(gc); j++)
             if (check_square_tree(gc, i, j))
                 if (neigh_count(gc, i, j, TENT, false) == 1 && neigh_count(gs, i, j, TENT, false) == 0) {
                     valid_unique_tent(gc, gs, i, j);
                     game_set_square(gc, i, j, EMPTY);
+                    nb++;
                 }
+    return nb;
 }
 
 // Place tents all over the game
@@ -405,9 +234,262 @@ static void only_keep_tents(game gc, game gs) {
                 game_set_square(gc, i, j, EMPTY);
 }
 
+static solver_search_fn backend_search(solver_backend backend) {
+    if (backend == SOLVER_BACKEND_SAT)
+        return solver_sat_search;
+    if (backend == SOLVER_BACKEND_DLX)
+        return solver_dlx_search;
+    return solver_search;
+}
+
+// Outcome of solvers that stopped without answer: CANCELLED if their cancel flag is set, TIMEOUT if one of them ran
+// out of time, LIMIT if one of them ran out of its other limits, UNSAT if none of them ran out of its budget
+static solve_status budget_status(solver *solvers, uint nb_solvers) {
+    if (solvers[0]->cancel != NULL && __atomic_load_n(solvers[0]->cancel, __ATOMIC_RELAXED))
+        return SOLVE_CANCELLED;
+    solve_status status = SOLVE_UNSAT;
+    for (uint k = 0; k < nb_solvers; k++)
+        if (solvers[k]->out_of_time)
+            status = SOLVE_TIMEOUT;
+        else if (solvers[k]->out_of_limits && status == SOLVE_UNSAT)
+            status = SOLVE_LIMIT;
+    return status;
+}
+
+// Adds the counters of the nb solvers of a call to stats (if not NULL), with the memory they use together
+static void add_stats(solver_stats *stats, solver *solvers, uint nb) {
+    if (stats == NULL)
+        return;
+    size_t memory = 0;
+    for (uint k = 0; k < nb; k++) {
+        stats->decisions += solvers[k]->nb_decisions;
+        stats->propagations += solvers[k]->nb_propagations;
+        stats->conflicts += solvers[k]->nb_conflicts;
+        stats->backtracks += solvers[k]->nb_backtracks;
+        memory += solver_memory(solvers[k]);
+    }
+    if (memory > stats->peak_memory)
+        stats->peak_memory = memory;
+}
+
+// Engines raced by the portfolio: a backend, with probing or line patterns for the native search
+static const struct {
+    const char *name;
+    solver_backend backend;
+    bool probing, line_patterns;
+} portfolio[] = {
+    {"search", SOLVER_BACKEND_SEARCH, false, false},
+    {"search+probing", SOLVER_BACKEND_SEARCH, true, false},
+    {"search+patterns", SOLVER_BACKEND_SEARCH, false, true},
+    {"sat", SOLVER_BACKEND_SAT, false, false},
+    {"dlx", SOLVER_BACKEND_DLX, false, false},
+};
+
+#define NB_ENGINES (sizeof(portfolio) / sizeof(portfolio[0]))
+
+// Solves the potential tents left in gs with every engine of the portfolio, and returns the solution (NULL if none,
+// status then telling whether an engine ran out of its budget)
+static game portfolio_solve(game gs, game gc, const solver_options *opts, solve_status *status) {
+    solver engines[NB_ENGINES];
+    solver_search_fn searches[NB_ENGINES];
+    for (uint e = 0; e < NB_ENGINES; e++) {
+        solver_options engine = *opts;
+        engine.backend = portfolio[e].backend;
+        engine.probing |= portfolio[e].probing;
+        engine.line_patterns |= portfolio[e].line_patterns;
+        if (e > 0)  // Only the plain search reports its progress
+            engine.progress = NULL;
+        engines[e] = solver_new(gs, gc);
+        solver_set_options(engines[e], &engine);
+        searches[e] = backend_search(engine.backend);
+    }
+
+    bool found;
+    int winner = solver_portfolio_solve(engines, searches, NB_ENGINES, &found);
+    if (opts->verbose && winner >= 0)
+        fprintf(stderr, "portfolio: %s answered first (%s)\n", portfolio[winner].name,
+                found ? "solution" : "no solution");
+    else if (opts->verbose)
+        fprintf(stderr, "portfolio: out of budget\n");
+    game sol = NULL;
+    *status = found ? SOLVE_SOLVED : SOLVE_UNSAT;
+    if (found) {
+        sol = game_copy(gs);
+        solver_export(engines[winner], sol);
+    }
+    if (winner < 0)
+        *status = budget_status(engines, NB_ENGINES);
+    add_stats(opts->stats, engines, NB_ENGINES);
+    for (uint e = 0; e < NB_ENGINES; e++)
+        solver_delete(engines[e]);
+    return sol;
+}
+
+/* A checkpointed count goes through the cubes of the search tree (see solver_split) one by one. Every period seconds,
+ * the count of the cubes done and the cubes left are saved in the checkpoint file:
+ *      Line 1 : nb_rows nb_cols fingerprint nb_sol nb_cubes_left (the fingerprint identifies the game and the modulus)
+ *      Next lines : nb_decisions followed by row col square for each decision, one line per cube left
+ * The file is written next to the checkpoint and then renamed, so that a process killed while saving keeps the
+ * previous checkpoint. The cubes being independent, a count resumed from the checkpoint gives the same result.
+ * A cube of the native search still being counted when the next checkpoint is due is given up (see count_deadline)
+ * and split into deeper cubes put at the end of the list, so that a process killed loses about one period of work
+ * however uneven the cubes are. A checkpoint that can't be written doesn't stop the count: it is counted in the
+ * statistics (checkpoint_failures), and the next one is tried a period later.
+ */
+
+#define CHECKPOINT_DEPTH 10  // At most 1024 cubes
+#define REFINE_DEPTH 4       // A cube given up is split into at most 16 cubes
+
+typedef struct frontier {
+    uint *lits;  // For each cube: its number of decisions, then its decisions (literals of solver_split)
+    uint size, capacity, nb_cubes;
+    uint *prefix, nb_prefix;  // Decisions put before the ones of the cubes kept (those of the cube being split)
+} frontier;
+
+static bool keep_cube(const uint *lits, uint nb_lits, void *data) {
+    frontier *f = data;
+    uint nb = f->nb_prefix + nb_lits;
+    if (f->size + nb + 1 > f->capacity) {
+        f->capacity = 2 * (f->size + nb + 1);
+        f->lits = realloc(f->lits, f->capacity * sizeof(uint));
+        assert(f->lits);
+    }
+    f->lits[f->size++] = nb;
+    for (uint k = 0; k < f->nb_prefix; k++)
+        f->lits[f->size++] = f->prefix[k];
+    for (uint k = 0; k < nb_lits; k++)
+        f->lits[f->size++] = lits[k];
+    f->nb_cubes++;
+    return true;
+}
+
+// FNV-1a hash of the squares, the expected numbers of tents and the options of g, and of the modulus of the count
+static unsigned long long fingerprint(game g, uint modulus) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (uint i = 0; i < game_nb_rows(g); i++)
+        for (uint j = 0; j < game_nb_cols(g); j++)
+            h = (h ^ game_get_square(g, i, j)) * 1099511628211ULL;
+    for (uint i = 0; i < game_nb_rows(g); i++)
+        h = (h ^ game_get_expected_nb_tents_row(g, i)) * 1099511628211ULL;
+    for (uint j = 0; j < game_nb_cols(g); j++)
+        h = (h ^ game_get_expected_nb_tents_col(g, j)) * 1099511628211ULL;
+    h = (h ^ game_is_wrapping(g)) * 1099511628211ULL;
+    h = (h ^ game_is_diagadj(g)) * 1099511628211ULL;
+    return (h ^ modulus) * 1099511628211ULL;
+}
+
+// Saves the count and the cubes of f from position next (the nb_left last cubes). Returns false if the checkpoint
+// couldn't be written, the previous one being kept then.
+static bool save_checkpoint(const solver_options *opts, game g, uint64_t nb_sol, const frontier *f, uint next,
+                            uint nb_left) {
+    char *tmp = malloc(strlen(opts->checkpoint) + 5);
+    assert(tmp);
+    sprintf(tmp, "%s.tmp", opts->checkpoint);
+    FILE *save = fopen(tmp, "w");
+    if (save == NULL) {
+        free(tmp);
+        return false;
+    }
+    uint nb_cols = game_nb_cols(g);
+    fprintf(save, "%u %u %llu %llu %u\n", game_nb_rows(g), nb_cols, fingerprint(g, opts->modulus),
+            (unsigned long long)nb_sol, nb_left);
+    while (next < f->size) {
+        uint nb_lits = f->lits[next++];
+        fprintf(save, "%u", nb_lits);
+        for (uint k = 0; k < nb_lits; k++, next++)
+            fprintf(save, " %u %u %c", (f->lits[next] >> 1) / nb_cols, (f->lits[next] >> 1) % nb_cols,
+                    square_to_char((f->lits[next] & 1) ? GRASS : TENT));
+        fprintf(save, "\n");
+    }
+    bool ok = !ferror(save);
+    ok = fclose(save) == 0 && ok;
+    ok = ok && rename(tmp, opts->checkpoint) == 0;
+    if (!ok)
+        remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+// Loads the count and the cubes left saved in the checkpoint. Returns false if there is no valid checkpoint for g.
+static bool load_checkpoint(const solver_options *opts, game g, uint64_t *nb_sol, frontier *f) {
+    FILE *load = fopen(opts->checkpoint, "r");
+    if (!load)
+        return false;
+    uint nb_rows = 0, nb_cols = 0, nb_cubes = 0;
+    unsigned long long hash = 0, nb = 0;
+    bool ok = fscanf(load, "%u %u %llu %llu %u", &nb_rows, &nb_cols, &hash, &nb, &nb_cubes) == 5;
+    ok = ok && nb_rows == game_nb_rows(g) && nb_cols == game_nb_cols(g) && hash == fingerprint(g, opts->modulus);
+    uint *lits = malloc(nb_rows * nb_cols * sizeof(uint));
+    assert(lits);
+    for (uint c = 0; c < nb_cubes && ok; c++) {
+        uint nb_lits = 0;
+        ok = fscanf(load, "%u", &nb_lits) == 1 && nb_lits <= nb_rows * nb_cols;
+        for (uint k = 0; k < nb_lits && ok; k++) {
+            uint i = 0, j = 0;
+            char sq = ' ';
+            ok = fscanf(load, "%u %u %c", &i, &j, &sq) == 3 && i < nb_rows && j < nb_cols;
+            lits[k] = 2 * (i * nb_cols + j) + (char_to_square(sq) != TENT);
+        }
+        if (ok)
+            keep_cube(lits, nb_lits, f);
+    }
+    free(lits);
+    fclose(load);
+    *nb_sol = nb;
+    return ok;
+}
+
+// Counts the solutions cube by cube, saving a checkpoint every opts->checkpoint_period seconds
+static uint64_t count_with_checkpoints(solver s, game g, solver_search_fn search, const solver_options *opts) {
+    frontier f = {NULL, 0, 0, 0, NULL, 0};
+    uint64_t nb_sol = 0;
+    uint nb_split;
+    if (!opts->resume || !load_checkpoint(opts, g, &nb_sol, &f)) {
+        f.size = f.nb_cubes = 0;
+        nb_sol = 0;
+        solver_split(s, CHECKPOINT_DEPTH, keep_cube, &f, &nb_split);
+    }
+
+    uint nb_failures = 0;
+    double last = solver_now();
+    uint next = 0;
+    for (uint c = 0; c < f.nb_cubes; c++) {
+        if (solver_now() - last >= opts->checkpoint_period) {
+            nb_failures += !save_checkpoint(opts, g, nb_sol, &f, next, f.nb_cubes - c);
+            last = solver_now();
+        }
+        uint mark = s->trail_size, nb_lits = f.lits[next++], first = next;
+        bool ok = true;
+        for (uint k = 0; k < nb_lits; k++, next++)
+            ok = ok && solver_assign(s, f.lits[next] >> 1, (f.lits[next] & 1) ? SOLVER_GRASS : SOLVER_TENT);
+        s->count_deadline = opts->checkpoint_period > 0 ? last + opts->checkpoint_period : 0;
+        s->count_aborted = false;
+        uint64_t nb_cube = ok ? search(s, 0) : 0;
+        if (s->count_aborted) {  // Split into deeper cubes, counted after the next checkpoint
+            f.nb_prefix = nb_lits;
+            f.prefix = malloc((nb_lits + 1) * sizeof(uint));
+            assert(f.prefix);
+            memcpy(f.prefix, f.lits + first, nb_lits * sizeof(uint));  // f.lits moves when the new cubes are kept
+            s->count_deadline = 0;
+            solver_split(s, REFINE_DEPTH, keep_cube, &f, &nb_split);
+            free(f.prefix);
+            f.prefix = NULL;
+            f.nb_prefix = 0;
+        } else
+            nb_sol = solver_count_add(s, nb_sol, nb_cube);
+        solver_undo(s, mark);
+    }
+    s->count_deadline = 0;
+    nb_failures += !save_checkpoint(opts, g, nb_sol, &f, next, 0);  // A resumed count then only reads it
+    if (opts->stats != NULL)
+        opts->stats->checkpoint_failures += nb_failures;
+    free(f.lits);
+    return nb_sol;
+}
+
 /* ************************************************************************** */
 
-/* This function is common to both functions solve and nb_solutions
+/* These functions are common to the functions solve and nb_solutions, and to the cubes
  * The logic adopted in order to reduce the number of tent solutions to be placed as much as possible is as follows:
  *      Step 1 : We start by placing tents everywhere on the game (except on the trees).
  *      Step 2 : Then, we can delete all the tents that are on a row or column where the number of expected tents is 0.
@@ -420,15 +502,25 @@ static void only_keep_tents(game gc, game gs) {
  *                  -> Third : All the tents linked to a single tree which is itself alone are placed.
  *                  -> Fourth : All tents that cannot be placed (expected rule) are deleted.
  *
- *      Step 5 : We create a table with all the potential tents that remain to be placed. We then test all possible tent combinations.
+ *      Step 5 : The potential tents that remain to be placed are handed to the search engine (see solver.c), which
+ *               decides them one by one and propagates the rules after each decision, or to the SAT backend (see
+ *               solver_sat.c) or the dancing links backend (see solver_dlx.c) depending on the options.
+ *               Narrow boards are counted line by line instead, right after Steps 1 and 2 when they have no tent
+ *               (see solver_dp.c), and the search can be shared between several threads (see solver_parallel.c).
+ *               With the portfolio backend, several engines race to solve the board, each one on its own thread. A
+ *               count can also be checkpointed to be resumed, and a solve can run in the background on a shared
+ *               thread pool (see game_async.c).
 */
-static game_and_nb common_treatment(game g, bool solve, bool count) {
-    assert(g);
-    game_and_nb rt = empty_game_nb();
 
+// Steps 1 to 4: gs receives the squares decided and gc the potential tents left. Returns false if g has no solution.
+// The squares decided by Step 4 and the times of the steps are added to stats (if not NULL).
+static bool reduce(game g, game *pgc, game *pgs, solver_stats *stats) {
+    double start = solver_now();
     game gc = place_all_tents(g);  // Step 1 / 2
+    double placed = solver_now();
+    if (stats != NULL)
+        stats->place_seconds += placed - start;
 
-    uint nb_sol = 0;
     game gs = game_copy(gc);
     game_restart(gs);
 
@@ -436,82 +528,252 @@ static game_and_nb common_treatment(game g, bool solve, bool count) {
     for (uint i = 0; i < game_nb_rows(g); i++)
         for (uint j = 0; j < game_nb_cols(g); j++)
             if (check_square_tent(g, i, j)) {
-                if (game_check_move(gs, i, j, TENT) == LOSING)
-                    return rt;
+                if (game_check_move(gs, i, j, TENT) == LOSING) {
+                    game_delete(gc);
+                    game_delete(gs);
+                    if (stats != NULL)
+                        stats->propagation_seconds += solver_now() - placed;
+                    return false;
+                }
                 else
                     game_set_square(gs, i, j, TENT);
             }
 
     bool changement = true;
     game check_changement = NULL;
+    uint nb_reduced[4] = {0, 0, 0, 0};
 
     // Step 4
     while (changement) {
         changement = false;
         check_changement = game_copy(gs);
 
-        copy_safe_tents(gc, gs);  // First
-        remove_with_losing(gc, gs);  // Second
-        valid_tents_with_one_tree(gc, gs);  // Third
-        delete_tents_expected(gc, gs);  // Fourth
+        nb_reduced[0] += copy_safe_tents(gc, gs);  // First
+        nb_reduced[1] += remove_with_losing(gc, gs);  // Second
+        nb_reduced[2] += valid_tents_with_one_tree(gc, gs);  // Third
+        nb_reduced[3] += delete_tents_expected(gc, gs);  // Fourth
 
         if (!game_equal(gs, check_changement))
             changement = true;
         game_delete(check_changement);
     }
 
-    if (nb_square_all(gc, TENT) < nb_square_all(gs, TREE) - nb_square_all(gs, TENT))
-        return rt;
-
-    // Step 5
-    only_keep_tents(gc, gs);
+    if (stats != NULL) {
+        stats->safe_tents += nb_reduced[0];
+        stats->losing_tents += nb_reduced[1];
+        stats->single_tree_tents += nb_reduced[2];
+        stats->full_row_tents += nb_reduced[3];
+        stats->propagation_seconds += solver_now() - placed;
+    }
 
-    coor *remain_coor = calloc(nb_square_all(gc, TENT) + 1, sizeof(coor));
-    assert(remain_coor);
-    uint index = 0;
+    if (nb_square_all(gc, TENT) < nb_square_all(gs, TREE) - nb_square_all(gs, TENT)) {
+        game_delete(gc);
+        game_delete(gs);
+        return false;
+    }
 
-    for (int i = 0; i < game_nb_rows(gc); i++)
-        for (int j = 0; j < game_nb_cols(gc); j++)
-            if (check_square_tent(gc, i, j)) {
-                remain_coor[index] = make_coor(i, j);
-                index++;
-            }
+    only_keep_tents(gc, gs);
+    *pgc = gc;
+    *pgs = gs;
+    return true;
+}
 
-    int n = nb_square_all(gc, TENT);
-    int k = nb_square_all(gs, TREE) - nb_square_all(gs, TENT);
-    nb_sol = 1;
+// Whether a count of g goes to the dynamic programming before Steps 3 and 4: narrow boards without tents, counted by
+// the native search
+static bool is_narrow(cgame g, const solver_options *opts) {
+    uint width = game_nb_rows(g) < game_nb_cols(g) ? game_nb_rows(g) : game_nb_cols(g);
+    return (opts->backend == SOLVER_BACKEND_SEARCH || opts->backend == SOLVER_BACKEND_PORTFOLIO) &&
+           width <= opts->dp_width && nb_square_all(g, TENT) == 0;
+}
 
-    game solution = NULL;
+// Counts a narrow board by dynamic programming on the potential tents of Steps 1 and 2 (Step 4 costs more than the
+// count itself on long boards). Returns false if the dynamic programming gave up: the board is then searched after
+// Step 4, without trying it again.
+static bool count_narrow(game g, uint64_t limit, const solver_options *opts, game_and_nb *rt) {
+    double start = solver_now();
+    game gc = place_all_tents(g);  // Step 1 / 2
+    game gs = game_copy(gc);
+    game_restart(gs);
+    double placed = solver_now();
+    solver s = solver_new(gs, gc);
+    solver_set_options(s, opts);
+    uint64_t nb_sol = 0;
+    bool counted = solver_dp_count(s, opts->dp_width, &nb_sol);
+    if (counted) {
+        if (limit != 0 && nb_sol > limit)
+            nb_sol = limit;
+        rt->nb = opts->modulus != 0 ? nb_sol % opts->modulus : nb_sol;
+        rt->overflow = s->overflow;
+        rt->nb_unknown = s->nb_free;
+    }
+    add_stats(opts->stats, &s, 1);
+    if (opts->stats != NULL) {
+        opts->stats->place_seconds += placed - start;
+        opts->stats->search_seconds += solver_now() - placed;
+    }
+    solver_delete(s);
+    game_delete(gc);
+    game_delete(gs);
+    return counted;
+}
 
-    if (k > 0) {  // Game is already finished
-        if (solve) {
-            solution = getOneSolution(remain_coor, n, k, gs);
-            if (!gs)
-                return rt;
-        }
+// With count, the search stops after limit solutions (0 for no limit)
+static game_and_nb common_treatment(game g, bool solve, bool count, uint64_t limit, const solver_options *opts) {
+    assert(g && opts);
+    game_and_nb rt = empty_game_nb();
+    bool narrow = count && !solve && is_narrow(g, opts);
+    if (narrow && count_narrow(g, limit, opts, &rt))
+        return rt;
+    game gc, gs;
+    if (!reduce(g, &gc, &gs, opts->stats))
+        return rt;
 
-        if (count)
-            nb_sol = getNbrSolution(remain_coor, n, k, gs);
-    } else {
+    // Step 5
+    double start = solver_now();
+    solver_options native = *opts;  // The portfolio only races to solve: it counts with the native search
+    if (native.backend == SOLVER_BACKEND_PORTFOLIO) {
         if (solve)
-            solution = game_copy(gs);
+            rt.g = portfolio_solve(gs, gc, opts, &rt.status);
+        solve = false;
+        native.backend = SOLVER_BACKEND_SEARCH;
     }
-
-    if (solve)
-        rt.g = solution;
+    opts = &native;
+
+    solver s = solver_new(gs, gc);
+    solver_set_options(s, opts);
+    solver_search_fn search = backend_search(opts->backend);
+    bool parallel = opts->backend == SOLVER_BACKEND_SEARCH && opts->nb_threads > 1;
+    solver *workers = NULL;
+    if (parallel) {  // The first worker is s, the others work on copies of the board
+        workers = malloc(opts->nb_threads * sizeof(solver));
+        assert(workers);
+        workers[0] = s;
+        s->progress = NULL;  // The workers would report concurrently
+        for (uint w = 1; w < opts->nb_threads; w++) {
+            workers[w] = solver_new(gs, gc);
+            solver_set_options(workers[w], opts);
+            workers[w]->progress = NULL;
+        }
+    }
+    if (solve && parallel) {
+        int w = solver_parallel_solve(workers, opts->nb_threads);
+        if (w >= 0) {
+            rt.g = game_copy(gs);
+            solver_export(workers[w], rt.g);
+            rt.status = SOLVE_SOLVED;
+        } else
+            rt.status = budget_status(workers, opts->nb_threads);
+    } else if (solve && search(s, 1) == 1) {
+        rt.g = game_copy(gs);
+        solver_export(s, rt.g);
+        rt.status = SOLVE_SOLVED;
+    } else if (solve)
+        rt.status = budget_status(&s, 1);
+    if (rt.status == SOLVE_TIMEOUT || rt.status == SOLVE_LIMIT) {  // Deductions of the root
+        // The nogoods of a search on one thread hold at the root, those of the workers only within their last cube
+        uint mark = s->trail_size;
+        if (parallel || opts->backend != SOLVER_BACKEND_SEARCH ? solver_prepare(s) : solver_prepare_learnt(s)) {
+            rt.g = game_copy(gs);
+            solver_export_partial(s, rt.g);
+        } else
+            rt.status = SOLVE_UNSAT;
+        solver_undo(s, mark);
+    }
+    uint64_t nb_sol = 0;
+    bool counted = !count || (opts->backend == SOLVER_BACKEND_SEARCH && !narrow && solver_dp_count(s, opts->dp_width, &nb_sol));
+    if (!counted && limit != 0) {  // The search stops as soon as it has found limit solutions
+        nb_sol = search(s, limit);
+        counted = true;
+    }
+    if (!counted && opts->checkpoint != NULL) {
+        nb_sol = count_with_checkpoints(s, g, search, opts);
+        counted = true;
+    }
+    if (!counted && parallel) {
+        nb_sol = solver_parallel_count(workers, opts->nb_threads);
+        counted = true;
+    }
+    if (!counted)
+        nb_sol = search(s, 0);
+    if (parallel)
+        add_stats(opts->stats, workers, opts->nb_threads);
+    else
+        add_stats(opts->stats, &s, 1);
+    if (parallel) {
+        for (uint w = 1; w < opts->nb_threads; w++)
+            solver_delete(workers[w]);
+        free(workers);
+    }
+    if (limit != 0 && nb_sol > limit)
+        nb_sol = limit;
+    if (opts->modulus != 0)  // The backends counting the solutions one by one don't reduce their counts
+        nb_sol %= opts->modulus;
     rt.nb = nb_sol;
+    rt.overflow = s->overflow;
+    rt.nb_unknown = s->nb_free;
 
+    solver_delete(s);
     game_delete(gc);
     game_delete(gs);
-    free(remain_coor);
+    if (opts->stats != NULL) {
+        double end = solver_now();
+        opts->stats->search_seconds += end - start;
+        if (rt.status == SOLVE_SOLVED) {
+            opts->stats->verified = game_is_over(rt.g);
+            opts->stats->verification_seconds += solver_now() - end;
+        }
+    }
     return rt;
 }
 
+solver_options solver_default_options(void) {
+    solver_options opts;
+    opts.backend = SOLVER_BACKEND_SEARCH;
+    opts.branching = SOLVER_BRANCHING_MRV;
+    opts.line_patterns = false;
+    opts.probing = false;
+    opts.probe_budget = 0;
+    opts.learning = true;
+    opts.components = true;
+    opts.caching = true;
+    opts.nb_threads = 1;
+    opts.dp_width = 8;
+    opts.verbose = false;
+    opts.checkpoint = NULL;
+    opts.checkpoint_period = 60;
+    opts.resume = false;
+    opts.modulus = 0;
+    opts.max_seconds = 0;
+    opts.max_nodes = 0;
+    opts.max_memory = 0;
+    opts.progress = NULL;
+    opts.progress_data = NULL;
+    opts.progress_period = 1;
+    opts.stats = NULL;
+    opts.cancel = NULL;
+    opts.seed = 0;
+    return opts;
+}
+
 bool game_solve(game g) {
-    game_and_nb rt = common_treatment(g, true, false);
+    solver_options opts = solver_default_options();
+    return game_solve_ext(g, &opts);
+}
 
-    if (rt.g == NULL)
+uint game_nb_solutions(game g) {
+    solver_options opts = solver_default_options();
+    uint64_t nb_sol = game_nb_solutions_ext(g, &opts);
+    return nb_sol > UINT_MAX ? UINT_MAX : nb_sol;
+}
+
+bool game_solve_ext(game g, const solver_options *opts) {
+    game_and_nb rt = common_treatment(g, true, false, 0, opts);
+
+    if (rt.status != SOLVE_SOLVED) {
+        if (rt.g != NULL)
+            game_delete(rt.g);
         return false;
+    }
 
     // Copy of all winning game
     for (int i = 0; i < game_nb_rows(rt.g); i++)
@@ -521,7 +783,416 @@ bool game_solve(game g) {
     return true;
 }
 
-uint game_nb_solutions(game g) {
-    game_and_nb rt = common_treatment(g, false, true);
+solve_status game_solve_budget(game g, const solver_options *opts) {
+    game_and_nb rt = common_treatment(g, true, false, 0, opts);
+    if (rt.g != NULL) {  // The solution, or the squares deduced
+        for (int i = 0; i < game_nb_rows(rt.g); i++)
+            for (int j = 0; j < game_nb_cols(rt.g); j++)
+                game_set_square(g, i, j, game_get_square(rt.g, i, j));
+        game_delete(rt.g);
+    }
+    return rt.status;
+}
+
+uint64_t game_nb_solutions_ext(game g, const solver_options *opts) {
+    game_and_nb rt = common_treatment(g, false, true, 0, opts);
     return rt.nb;
-}
\ No newline at end of file
+}
+
+uint game_solution_count_capped(game g, uint limit) {
+    assert(g && limit > 0);
+    solver_options opts = solver_default_options();
+    return common_treatment(g, false, true, limit, &opts).nb;
+}
+
+bool game_has_unique_solution(game g) {
+    return game_solution_count_capped(g, 2) == 1;
+}
+
+typedef struct enumeration {
+    unsigned char *tents;  // Bitmap of the tents of the solution, reused from one solution to the next
+    solution_callback callback;
+    void *user_data;
+} enumeration;
+
+static bool emit_solution(solver s, void *data) {
+    enumeration *e = data;
+    memset(e->tents, 0, (s->nb_cells + 7) / 8);
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (s->value[c] == SOLVER_TENT)
+            e->tents[c / 8] |= 1 << (c % 8);
+    return e->callback(e->tents, e->user_data);
+}
+
+uint64_t game_enumerate_solutions(game g, solution_callback callback, void *user_data, uint64_t max) {
+    assert(g && callback);
+    game gc, gs;
+    if (!reduce(g, &gc, &gs, NULL))
+        return 0;
+    solver_options opts = solver_default_options();
+    solver s = solver_new(gs, gc);
+    solver_set_options(s, &opts);
+    enumeration e = {calloc((s->nb_cells + 7) / 8, 1), callback, user_data};
+    assert(e.tents);
+    s->on_solution = emit_solution;
+    s->on_solution_data = &e;
+    uint64_t nb_sol = solver_search(s, max);
+    free(e.tents);
+    solver_delete(s);
+    game_delete(gc);
+    game_delete(gs);
+    return nb_sol;
+}
+
+bool game_sample_solution(game g, uint64_t *rng) {
+    assert(g && rng);
+    game gc, gs;
+    if (!reduce(g, &gc, &gs, NULL))
+        return false;
+    solver_options opts = solver_default_options();
+    solver s = solver_new(gs, gc);
+    solver_set_options(s, &opts);
+    bool found;
+    if (!solver_dp_sample(s, opts.dp_width, rng, &found))
+        found = solver_sample(s, rng);
+    if (found) {
+        solver_export(s, gs);
+        for (int i = 0; i < game_nb_rows(gs); i++)
+            for (int j = 0; j < game_nb_cols(gs); j++)
+                game_set_square(g, i, j, game_get_square(gs, i, j));
+    }
+    solver_delete(s);
+    game_delete(gc);
+    game_delete(gs);
+    return found;
+}
+
+/* ************************************************************************** */
+/*                               CUBE FUNCTIONS                               */
+/* ************************************************************************** */
+
+/* A cube file holds the decisions leading to one part of the search tree (see solver_split):
+ *      Line 1 : nb_rows nb_cols fingerprint nb_decisions (the fingerprint identifies the game, like in a checkpoint)
+ *      Next lines : row col square ('*' for a tent, '-' for grass), one line per decision
+ * The decisions are taken after Steps 1 to 4 of common_treatment, which are redone the same way to count a cube.
+ * The number of cubes is saved last in <prefix>.cubes, so that the cubes of an older split with the same prefix
+ * aren't taken for cubes of this one.
+ */
+
+typedef struct cube_files {
+    char *prefix;
+    uint nb_rows, nb_cols, nb_cubes;
+    unsigned long long fingerprint;
+} cube_files;
+
+// Saves a cube in the file <prefix><number of the cube>.cube. Returns false if the file couldn't be written.
+static bool save_cube(const uint *lits, uint nb_lits, void *data) {
+    cube_files *files = data;
+    char *filename = malloc(strlen(files->prefix) + 16);
+    assert(filename);
+    sprintf(filename, "%s%u.cube", files->prefix, files->nb_cubes);
+    FILE *save = fopen(filename, "w");
+    free(filename);
+    if (save == NULL)
+        return false;
+    fprintf(save, "%u %u %llu %u\n", files->nb_rows, files->nb_cols, files->fingerprint, nb_lits);
+    for (uint k = 0; k < nb_lits; k++) {
+        uint cell = lits[k] >> 1;
+        fprintf(save, "%u %u %c\n", cell / files->nb_cols, cell % files->nb_cols,
+                square_to_char((lits[k] & 1) ? GRASS : TENT));
+    }
+    bool ok = !ferror(save);
+    ok = fclose(save) == 0 && ok;
+    files->nb_cubes += ok;
+    return ok;
+}
+
+bool game_save_cubes(game g, uint depth, char *prefix, const solver_options *opts, uint *nb_cubes) {
+    assert(g && prefix && opts && nb_cubes);
+    char *filename = malloc(strlen(prefix) + 7);
+    assert(filename);
+    sprintf(filename, "%s.cubes", prefix);
+    remove(filename);  // The count of an older split doesn't hold while the cubes are rewritten
+
+    cube_files files = {prefix, game_nb_rows(g), game_nb_cols(g), 0, fingerprint(g, 0)};
+    bool ok = true;
+    game gc, gs;
+    if (reduce(g, &gc, &gs, NULL)) {
+        solver s = solver_new(gs, gc);
+        solver_set_options(s, opts);
+        ok = solver_split(s, depth, save_cube, &files, nb_cubes);
+        solver_delete(s);
+        game_delete(gc);
+        game_delete(gs);
+    } else
+        *nb_cubes = 0;
+
+    FILE *save = ok ? fopen(filename, "w") : NULL;
+    free(filename);
+    if (save == NULL)
+        return false;
+    fprintf(save, "%u\n", *nb_cubes);
+    ok = !ferror(save);
+    return fclose(save) == 0 && ok;
+}
+
+// Reads the decisions of a cube file made for g (as literals, like solver_split gives them). Returns false if the
+// file can't be read or wasn't made for g.
+static bool load_cube(game g, char *filename, uint **lits, uint *nb_lits) {
+    FILE *load = fopen(filename, "r");
+    if (load == NULL)
+        return false;
+    uint nb_rows = 0, nb_cols = 0, nb_decisions = 0;
+    unsigned long long hash = 0;
+    bool ok = fscanf(load, "%u %u %llu %u", &nb_rows, &nb_cols, &hash, &nb_decisions) == 4 &&
+              nb_rows == game_nb_rows(g) && nb_cols == game_nb_cols(g) && hash == fingerprint(g, 0) &&
+              nb_decisions <= nb_rows * nb_cols;
+    *lits = malloc((ok ? nb_decisions : 0) * sizeof(uint) + 1);
+    assert(*lits);
+    for (uint k = 0; k < nb_decisions && ok; k++) {
+        uint i = 0, j = 0;
+        char c = ' ';
+        ok = fscanf(load, "%u %u %c", &i, &j, &c) == 3 && i < nb_rows && j < nb_cols && (c == '*' || c == '-');
+        (*lits)[k] = 2 * (i * nb_cols + j) + (c == '-');
+    }
+    fclose(load);
+    *nb_lits = nb_decisions;
+    if (!ok)
+        free(*lits);
+    return ok;
+}
+
+bool game_nb_solutions_cube(game g, char *filename, const solver_options *opts, uint64_t *nb_sol) {
+    assert(g && filename && opts && nb_sol);
+    uint *lits, nb_lits;
+    if (!load_cube(g, filename, &lits, &nb_lits))
+        return false;
+
+    *nb_sol = 0;
+    game gc, gs;
+    if (!reduce(g, &gc, &gs, NULL)) {
+        free(lits);
+        return true;
+    }
+    solver_options native = *opts;
+    if (native.backend == SOLVER_BACKEND_PORTFOLIO)
+        native.backend = SOLVER_BACKEND_SEARCH;
+    solver s = solver_new(gs, gc);
+    solver_set_options(s, &native);
+    bool ok = true;
+    for (uint k = 0; k < nb_lits && ok; k++)
+        ok = solver_assign(s, lits[k] >> 1, (lits[k] & 1) ? SOLVER_GRASS : SOLVER_TENT);
+    free(lits);
+
+    if (ok)
+        *nb_sol = backend_search(native.backend)(s, 0);
+    if (native.modulus != 0)
+        *nb_sol %= native.modulus;
+    solver_delete(s);
+    game_delete(gc);
+    game_delete(gs);
+    return true;
+}
+
+/* ************************************************************************** */
+/*                                EXACT COUNT                                 */
+/* ************************************************************************** */
+
+/* When the number of solutions doesn't fit in 64 bits, it is counted again modulo primes of 32 bits (so that the
+ * products of residues fit in 64 bits) until their product goes over 2^nb_unknown, a bound of the number of
+ * solutions. The number is then rebuilt from its residues with the Chinese remainder theorem, in the mixed radix
+ * form of Garner: x = v[0] + v[1] * p[0] + v[2] * p[0] * p[1] + ...
+ */
+
+static uint64_t pow_mod(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t r = 1;
+    for (a %= p; e > 0; e >>= 1, a = a * a % p)
+        if (e & 1)
+            r = r * a % p;
+    return r;
+}
+
+// Miller-Rabin test, exact below 2^32 with the bases 2, 7 and 61
+static bool is_prime(uint64_t n) {
+    uint64_t d = n - 1;
+    uint r = 0;
+    for (; d % 2 == 0; d /= 2)
+        r++;
+    uint64_t bases[] = {2, 7, 61};
+    for (uint k = 0; k < 3; k++) {
+        if (bases[k] % n == 0)
+            continue;
+        uint64_t x = pow_mod(bases[k], d, n);
+        for (uint i = 1; i < r && x != 1 && x != n - 1; i++)
+            x = x * x % n;
+        if (x != 1 && x != n - 1)
+            return false;
+    }
+    return true;
+}
+
+// Decimal writing of the number with the residues res modulo the nb primes p
+static char *crt_to_decimal(const uint64_t *p, const uint64_t *res, uint nb) {
+    uint64_t *v = malloc(nb * sizeof(uint64_t));
+    uint32_t *limbs = calloc(nb + 1, sizeof(uint32_t));  // Base 2^32, lowest limb first
+    assert(v && limbs);
+    for (uint i = 0; i < nb; i++) {
+        uint64_t t = 0, prod = 1;  // Prefix of the mixed radix form and product of the primes before, modulo p[i]
+        for (uint j = i; j-- > 0;)
+            t = (t * (p[j] % p[i]) + v[j]) % p[i];
+        for (uint j = 0; j < i; j++)
+            prod = prod * (p[j] % p[i]) % p[i];
+        v[i] = (res[i] % p[i] + p[i] - t) % p[i] * pow_mod(prod, p[i] - 2, p[i]) % p[i];
+    }
+
+    uint nb_limbs = 1;
+    limbs[0] = (uint32_t)v[nb - 1];
+    for (uint i = nb - 1; i-- > 0;) {  // x = x * p[i] + v[i]
+        uint64_t carry = v[i];
+        for (uint k = 0; k < nb_limbs; k++) {
+            uint64_t cur = (uint64_t)limbs[k] * p[i] + carry;
+            limbs[k] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        if (carry > 0)
+            limbs[nb_limbs++] = (uint32_t)carry;
+    }
+
+    char *str = malloc(10 * nb_limbs + 10);  // 2^32 < 10^10, written 9 digits at a time
+    assert(str);
+    uint len = 0;
+    do {  // Divides by 10^9 and writes the remainder, lowest digits first
+        uint64_t rem = 0;
+        for (uint k = nb_limbs; k-- > 0;) {
+            uint64_t cur = (rem << 32) | limbs[k];
+            limbs[k] = (uint32_t)(cur / 1000000000);
+            rem = cur % 1000000000;
+        }
+        while (nb_limbs > 1 && limbs[nb_limbs - 1] == 0)
+            nb_limbs--;
+        for (uint k = 0; k < 9; k++, rem /= 10)
+            str[len++] = '0' + rem % 10;
+    } while (nb_limbs > 1 || limbs[0] != 0);
+    while (len > 1 && str[len - 1] == '0')
+        len--;
+    for (uint k = 0; k < len / 2; k++) {
+        char c = str[k];
+        str[k] = str[len - 1 - k];
+        str[len - 1 - k] = c;
+    }
+    str[len] = '\0';
+    free(v);
+    free(limbs);
+    return str;
+}
+
+char *game_nb_solutions_exact(game g, const solver_options *opts) {
+    assert(g && opts);
+    solver_options o = *opts;
+    o.modulus = 0;
+    game_and_nb rt = common_treatment(g, false, true, 0, &o);
+    if (!rt.overflow) {
+        char *str = malloc(21);
+        assert(str);
+        sprintf(str, "%llu", (unsigned long long)rt.nb);
+        return str;
+    }
+
+    uint nb = rt.nb_unknown / 31 + 1;  // Each prime is over 2^31
+    uint64_t *p = malloc(nb * sizeof(uint64_t));
+    uint64_t *res = malloc(nb * sizeof(uint64_t));
+    assert(p && res);
+    uint64_t candidate = UINT32_MAX;
+    for (uint k = 0; k < nb; k++) {
+        while (!is_prime(candidate))
+            candidate -= 2;
+        p[k] = candidate;
+        candidate -= 2;
+        o.modulus = p[k];
+        res[k] = common_treatment(g, false, true, 0, &o).nb;
+    }
+    char *str = crt_to_decimal(p, res, nb);
+    free(p);
+    free(res);
+    return str;
+}
+
+/* ************************************************************************** */
+/*                              APPROXIMATE COUNT                             */
+/* ************************************************************************** */
+
+#define MIN_PROBES 10    // Probes made before the spread of the probes is trusted
+#define LOG10_2 0.30102999566398120
+
+/* The estimates of the probes only fit in doubles through their logarithms: the sums of the estimates and of their
+ * squares are kept divided by 2^max_log (max_log being the largest logarithm met), and scaled again when a larger one
+ * comes. With n probes of mean m and variance v, Chebyshev's inequality puts the mean of the probes within
+ * t = sqrt(v / (n * delta)) of the number of solutions with a probability of at least 1 - delta.
+ */
+typedef struct probe_sums {
+    uint n;
+    double max_log, sum, sum_sq;
+} probe_sums;
+
+static void add_probe(probe_sums *p, double log_nb) {
+    p->n++;
+    if (log_nb < 0)  // An estimate of 0
+        return;
+    if (log_nb > p->max_log) {
+        p->sum *= exp2(p->max_log - log_nb);
+        p->sum_sq *= exp2(2 * (p->max_log - log_nb));
+        p->max_log = log_nb;
+    }
+    double x = exp2(log_nb - p->max_log);
+    p->sum += x;
+    p->sum_sq += x * x;
+}
+
+// Half width of the interval, divided by 2^max_log like the mean
+static double half_width(const probe_sums *p, double delta) {
+    double mean = p->sum / p->n;
+    if (p->n < 2)  // No spread yet: the estimate may be off by its own size
+        return mean / sqrt(delta);
+    double var = (p->sum_sq - p->sum * mean) / (p->n - 1);
+    return sqrt((var > 0 ? var : 0) / (p->n * delta));
+}
+
+solution_estimate game_nb_solutions_approx(game g, double epsilon, double delta, double seconds,
+                                           const solver_options *opts) {
+    assert(g && epsilon > 0 && delta > 0 && delta < 1 && opts);
+    solution_estimate e = {false, 0, 0, 0, 0, true};
+    game gc, gs;
+    if (!reduce(g, &gc, &gs, NULL))
+        return e;
+    solver s = solver_new(gs, gc);
+    solver_options o = *opts;
+    o.modulus = 0;
+    solver_set_options(s, &o);
+
+    uint64_t nb_sol;
+    if (solver_dp_count(s, o.dp_width, &nb_sol) && !s->overflow) {
+        e.found = nb_sol > 0;
+        e.log10_nb = e.log10_low = e.log10_high = e.found ? log10((double)nb_sol) : 0;
+    } else {
+        probe_sums p = {0, 0, 0, 0};
+        uint64_t rng = o.seed;
+        double start = solver_now();
+        do {
+            add_probe(&p, solver_estimate(s, &rng));
+            e.converged = p.n >= MIN_PROBES && p.sum > 0 && half_width(&p, delta) <= epsilon * p.sum / p.n;
+        } while (!e.converged && solver_now() - start < seconds);
+
+        e.nb_probes = p.n;
+        e.found = p.sum > 0;
+        if (e.found) {
+            double mean = p.sum / p.n, t = half_width(&p, delta);
+            e.log10_nb = (p.max_log + log2(mean)) * LOG10_2;
+            e.log10_high = (p.max_log + log2(mean + t)) * LOG10_2;
+            e.log10_low = mean - t > exp2(-p.max_log) ? (p.max_log + log2(mean - t)) * LOG10_2 : 0;  // At least one
+        }
+    }
+    solver_delete(s);
+    game_delete(gc);
+    game_delete(gs);
+    return e;
+}
@@ -46,7 +46,10 @@ typedef struct game_s *game;
 /**
  * @brief The structure constant pointer that stores the game state.
  * @details That means that it is not possible to modify the game using this
- * pointer.
+ * pointer. The functions taking a cgame (game_get_*, game_check_move,
+ * game_is_over, game_copy, game_equal...) only read the game and keep no
+ * global state: they can be called at the same time from several threads on
+ * a shared game, as long as no thread modifies it meanwhile.
  **/
 typedef const struct game_s *cgame;
 
@@ -47,7 +47,7 @@ bool game_solve(game g);
 /**
  * @brief Computes the total number of solutions of a given game.
  * @param g the game
- * @return the number of solutions
+ * @return the number of solutions, or UINT_MAX if there are more (see game_nb_solutions_exact in game_tools_ext.h)
  */
 uint game_nb_solutions(game g);
 
@@ -0,0 +1,354 @@
+/**
+ * @file game_tools_ext.h
+ * @brief Extended Game Tools.
+ * @details Solver functions taking options. See @ref index for further details.
+ * The solvers keep no global state: several threads can solve or count games at the same time, each one on its own
+ * game (a copy of a shared game, see @ref cgame). The statistics and the callbacks given in the options belong to the
+ * thread solving with them.
+ **/
+
+#ifndef __GAME_TOOLS_EXT_H__
+#define __GAME_TOOLS_EXT_H__
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * @name Extended Game Tools
+ * @{
+ */
+
+/**
+ * @brief Engines able to decide the potential tents left by the deductions of the solver.
+ **/
+typedef enum {
+    SOLVER_BACKEND_SEARCH, /**< native search with propagation of the rules */
+    SOLVER_BACKEND_SAT,    /**< encoding of the rules into a SAT formula, solved by a built-in CDCL solver */
+    SOLVER_BACKEND_DLX,    /**< covering problem (rows, columns and trees covered by tents) solved with dancing links */
+    SOLVER_BACKEND_PORTFOLIO /**< when solving, the native search (alone, with probing and with line patterns) and the
+                                  two other backends race on their own threads, and the first answer wins; counting
+                                  uses the native search */
+} solver_backend;
+
+/**
+ * @brief Heuristics choosing the square decided next by the native search.
+ **/
+typedef enum {
+    SOLVER_BRANCHING_MRV,  /**< a square of the most constrained tree or line (trees first on a tie), the one in
+                                conflict with the most unknown squares and unsatisfied trees */
+    SOLVER_BRANCHING_FIRST /**< the first unknown square, row by row */
+} solver_branching;
+
+/**
+ * @brief Statistics of the solver (see solver_options::stats).
+ * @details The counters and the times add up over the calls given the same statistics, so that they start at zero
+ * (the exact count makes several calls); peak_memory keeps the highest memory of a call.
+ **/
+typedef struct solver_stats {
+    uint64_t decisions;          /**< decisions of the search */
+    uint64_t propagations;       /**< squares propagated by the native search */
+    uint64_t conflicts;          /**< contradictions met by the search */
+    uint64_t backtracks;         /**< second branches taken, and jumps back of the search */
+    uint safe_tents;             /**< Step 4 of game_tools.c, first pass: tents placed on the columns needing all their
+                                      potential tents */
+    uint losing_tents;           /**< second pass: potential tents removed because placing them is LOSING */
+    uint single_tree_tents;      /**< third pass: tents placed next to a tree with a single potential tent left */
+    uint full_row_tents;         /**< fourth pass: potential tents removed from the rows that have their tents */
+    double place_seconds;        /**< time placing every potential tent (Steps 1 and 2) */
+    double propagation_seconds;  /**< time applying the rules to them (Steps 3 and 4) */
+    double search_seconds;       /**< time of the search engines (Step 5) */
+    double verification_seconds; /**< time checking the solution found against the rules of the game */
+    bool verified;               /**< the last solution found satisfies the rules of the game */
+    size_t peak_memory;          /**< bytes of learned nogoods, reasons and caches of the solvers of a call */
+    uint checkpoint_failures;    /**< checkpoints of a count that couldn't be written (see solver_options::checkpoint) */
+} solver_stats;
+
+/**
+ * @brief State of a search reported to a @ref progress_callback.
+ **/
+typedef struct solver_progress {
+    double seconds;                 /**< time since the search started */
+    uint64_t nodes;                 /**< decisions taken so far */
+    uint depth;                     /**< number of decisions leading to the node being searched */
+    double propagations_per_second; /**< squares propagated per second since the search started */
+    double fraction;                /**< estimated share of the search tree already closed, between 0 and 1 (each
+                                         decision splits the share of its node in two) */
+} solver_progress;
+
+/**
+ * @brief Receives the progress of a long search (see solver_options::progress).
+ **/
+typedef void (*progress_callback)(const solver_progress *progress, void *user_data);
+
+/**
+ * @brief Options of the solver.
+ **/
+typedef struct solver_options {
+    solver_backend backend;  /**< engine used (the other options only apply to the native search) */
+    solver_branching branching; /**< square decided next by the native search */
+    bool line_patterns; /**< checks every line against the list of its possible tent patterns (lines of at most 20
+                             squares): the squares on which all the patterns left agree get their value */
+    bool probing;       /**< before each decision, tries both values of every unknown square and keeps the only
+                             possible one when the other leads to a contradiction */
+    uint probe_budget;  /**< maximum number of squares propagated by one probe, 0 for no limit */
+    bool learning;      /**< learns a nogood from each contradiction; when looking for one solution, also jumps back
+                             to the last decision the nogood depends on */
+    bool components;    /**< when counting, splits the squares left into independent groups counted separately (the
+                             number of solutions is the product of their numbers of solutions); learning is not used
+                             then */
+    bool caching;       /**< with components, remembers the number of solutions of every component counted, so that a
+                             component met again by another path is not searched twice */
+    uint nb_threads;    /**< number of threads searching the board, which share the search tree by work stealing (when
+                             solving, the first thread finding a solution stops the others) */
+    uint dp_width;      /**< when counting, boards whose smaller side has at most dp_width squares are counted by
+                             dynamic programming over their lines instead of being searched (0 to never do it), before
+                             Steps 3 and 4 when the board has no tent; the count keeps up to about
+                             (length / 2)^width states, so long boards are only counted when 2 to 4 squares wide,
+                             the others being searched when it gives up (see solver_dp_count) */
+    bool verbose;       /**< prints to stderr which engine of the portfolio answered first */
+    char *checkpoint;   /**< when counting, file in which the count done and the parts of the search left are saved
+                             every checkpoint_period seconds and at the end (NULL for none); the count then runs on
+                             one thread, part by part, and goes on when a checkpoint can't be written (see
+                             solver_stats::checkpoint_failures) */
+    uint checkpoint_period; /**< seconds between two checkpoints; a part of the native search running past the next
+                                 checkpoint is split into smaller parts, so that at most about a period of work is
+                                 lost (0 saves after every part, which are then never split) */
+    bool resume;        /**< resumes the count from the checkpoint file when there is a valid one for the game */
+    uint modulus;       /**< when not 0, a prime: the numbers of solutions are computed modulo it, so that they are
+                             exact modulo it whatever their size */
+    double max_seconds; /**< when solving, wall-clock time after which the search gives up (0 for no limit) */
+    uint64_t max_nodes; /**< when solving, decisions after which the search gives up, per thread (0 for no limit) */
+    size_t max_memory;  /**< when solving, bytes of learned nogoods, reasons and caches beyond which the search gives
+                             up (0 for no limit) */
+    progress_callback progress; /**< called by the native search, every progress_period seconds, with its progress
+                                     (NULL for none; only the plain search of the portfolio reports it, and the
+                                     parallel search doesn't) */
+    void *progress_data;        /**< passed to progress */
+    double progress_period;     /**< seconds between two calls to progress */
+    solver_stats *stats;        /**< receives the statistics of the solving or of the counting (NULL for none) */
+    const int *cancel;          /**< when solving, flag set to 1 by another thread to give up the search (NULL for
+                                     none; read atomically by the search between two decisions) */
+    uint64_t seed;              /**< state the random paths of @ref game_nb_solutions_approx start from: the same seed
+                                     gives the same probes, so the same estimate when the precision is reached before
+                                     the time is up */
+} solver_options;
+
+/**
+ * @brief Outcome of a solve with a budget (see @ref game_solve_budget).
+ **/
+typedef enum {
+    SOLVE_SOLVED,  /**< a solution was found */
+    SOLVE_UNSAT,   /**< the game has no solution */
+    SOLVE_TIMEOUT, /**< max_seconds ran out first */
+    SOLVE_LIMIT,   /**< max_nodes or max_memory ran out first */
+    SOLVE_CANCELLED /**< the cancel flag was set first */
+} solve_status;
+
+/**
+ * @brief Gets the default options of the solver (the ones used by @ref game_solve and @ref game_nb_solutions).
+ * @return the default options
+ **/
+solver_options solver_default_options(void);
+
+/**
+ * @brief Computes the solution of a given game with the given options.
+ * @param g the game to solve
+ * @param opts the options of the solver
+ * @details Same as @ref game_solve.
+ * @return true if a solution is found, false otherwise
+ **/
+bool game_solve_ext(game g, const solver_options *opts);
+
+/**
+ * @brief Solves a given game within the budget of the options (max_seconds, max_nodes and max_memory).
+ * @param g the game to solve
+ * @param opts the options of the solver (the budget bounds the native search, alone, on several threads or in the
+ * portfolio, the dancing links backend, whose choices are its nodes, and the SAT backend, whose decisions are its nodes
+ * and whose formula counts in its memory)
+ * @details When solved, g receives the solution like with @ref game_solve. When the budget runs out, g receives
+ * the squares deduced so far, which hold in every solution: the tents and the grass deduced, the other squares being
+ * EMPTY. Those are the propagation of the rules at the root of the search, with the nogoods learned by the native
+ * search on one thread (learning enabled) and the probes when probing is enabled; the other engines only give the
+ * propagation of the rules. When there is no solution, g is unchanged.
+ * @return the outcome of the solve
+ **/
+solve_status game_solve_budget(game g, const solver_options *opts);
+
+/**
+ * @brief Computes the total number of solutions of a given game with the given options.
+ * @param g the game
+ * @param opts the options of the solver
+ * @return the number of solutions (modulo opts->modulus if it is not 0), or UINT64_MAX if it doesn't fit in 64 bits
+ * (see @ref game_nb_solutions_exact)
+ **/
+uint64_t game_nb_solutions_ext(game g, const solver_options *opts);
+
+/**
+ * @brief Computes the exact number of solutions of a given game, whatever its size.
+ * @param g the game
+ * @param opts the options of the solver (its modulus is not used)
+ * @details When the number doesn't fit in 64 bits, it is counted again modulo enough primes to rebuild it.
+ * @return the number of solutions in decimal, to be freed by the caller
+ **/
+char *game_nb_solutions_exact(game g, const solver_options *opts);
+
+/**
+ * @brief Estimate of the number of solutions of a game (see @ref game_nb_solutions_approx). The numbers are given by
+ * their decimal logarithms, so that they fit whatever the size of the board.
+ **/
+typedef struct solution_estimate {
+    bool found;        /**< a solution was met, so there is at least one (the logarithms are 0 otherwise) */
+    double log10_nb;   /**< decimal logarithm of the estimated number of solutions */
+    double log10_low;  /**< decimal logarithm of the lower bound of the confidence interval */
+    double log10_high; /**< decimal logarithm of the upper bound of the confidence interval */
+    uint nb_probes;    /**< number of random probes of the search tree made (0 when the count is exact) */
+    bool converged;    /**< the interval is within the relative precision asked, with the confidence asked */
+} solution_estimate;
+
+/**
+ * @brief Estimates the number of solutions of a given game within a time budget, for boards too large to be counted.
+ * @param g the game
+ * @param epsilon relative precision wanted (0.1 for an interval of +/- 10 % around the estimate)
+ * @param delta probability allowed for the number of solutions to be out of the interval
+ * @param seconds wall-clock time budget (at least one probe is made)
+ * @param opts the options of the native search (backend, threads and modulus are not used), and the seed of the
+ * random paths
+ * @details Boards counted by dynamic programming (see solver_options::dp_width) get their exact count. Otherwise
+ * the search tree is probed along random paths (Knuth's estimator, the small independent parts of the board being
+ * counted exactly) until the interval given by Chebyshev's inequality on the spread of the probes is narrow enough
+ * or the time is up. The interval relies on the spread observed, which a few rare heavy paths can hide.
+ * @return the estimate
+ **/
+solution_estimate game_nb_solutions_approx(game g, double epsilon, double delta, double seconds,
+                                           const solver_options *opts);
+
+/**
+ * @brief Computes the number of solutions of a given game, stopping as soon as limit solutions are found.
+ * @param g the game
+ * @param limit the maximum number of solutions to find (at least 1)
+ * @details Only limit solutions are looked for, so that checking that a game has one solution costs about as much
+ * as solving it.
+ * @return the number of solutions if it is below limit, limit otherwise
+ **/
+uint game_solution_count_capped(game g, uint limit);
+
+/**
+ * @brief Checks whether a given game has exactly one solution (see @ref game_solution_count_capped).
+ * @param g the game
+ * @return true if the game has one solution, false if it has none or several
+ **/
+bool game_has_unique_solution(game g);
+
+/**
+ * @brief Receives a solution found by @ref game_enumerate_solutions.
+ * @param tents bitmap of the tents of the solution: the square (i, j) holds a tent if the bit k % 8 of tents[k / 8] is
+ * set, with k = i * nb_cols + j (the bitmap is only valid during the call)
+ * @param user_data the pointer given to @ref game_enumerate_solutions
+ * @return true to go on with the enumeration, false to stop it
+ **/
+typedef bool (*solution_callback)(const unsigned char *tents, void *user_data);
+
+/**
+ * @brief Passes the solutions of a given game one by one to a callback, without creating a game for each of them.
+ * @param g the game
+ * @param callback the function receiving the solutions
+ * @param user_data pointer passed to the callback
+ * @param max the enumeration stops after max solutions (0 for no limit)
+ * @return the number of solutions passed to the callback
+ **/
+uint64_t game_enumerate_solutions(game g, solution_callback callback, void *user_data, uint64_t max);
+
+/**
+ * @brief Replaces the tents of a given game by a solution drawn uniformly at random among all its solutions.
+ * @param g the game
+ * @param rng state of the random generator (any value to start with), advanced by the draw: the same state gives the
+ * same solution
+ * @details Each decision of the draw counts the solutions of its two branches (the boards counted by dynamic
+ * programming, see solver_options::dp_width, are drawn from the tables of that count instead), so a draw costs a few
+ * counts of the solutions of the game, never their enumeration. The draw is exact as long as the independent parts
+ * of the game have less than 2^64 solutions each.
+ * @return true if a solution was drawn, false if there is none (the game is then unchanged)
+ **/
+bool game_sample_solution(game g, uint64_t *rng);
+
+/**
+ * @brief Splits the search for the solutions of a given game into independent cubes, saved in files.
+ * @param g the game
+ * @param depth maximum number of decisions of a cube
+ * @param prefix the cubes are saved in the files <prefix>0.cube, <prefix>1.cube..., and their number in <prefix>.cubes
+ * @param opts the options of the solver (the decisions are taken by its heuristic)
+ * @param nb_cubes receives the number of cube files saved
+ * @details Every solution of the game belongs to exactly one cube, so that the number of solutions of the game is
+ * the sum of the numbers of solutions of the cubes (see @ref game_nb_solutions_cube). Each cube file records the
+ * game it was made for. <prefix>.cubes is only written once every cube is saved.
+ * @return false if a file couldn't be written (<prefix>.cubes is then missing)
+ **/
+bool game_save_cubes(game g, uint depth, char *prefix, const solver_options *opts, uint *nb_cubes);
+
+/**
+ * @brief Computes the number of solutions of a given game within a cube saved by @ref game_save_cubes.
+ * @param g the game the cube was made from
+ * @param filename the cube file
+ * @param opts the options of the solver (the count is done by the backend alone)
+ * @param nb_sol receives the number of solutions containing the decisions of the cube (modulo opts->modulus if it is
+ * not 0)
+ * @return false if the cube file can't be opened, is truncated or malformed, or was made for another game (nb_sol is
+ * then left unchanged)
+ **/
+bool game_nb_solutions_cube(game g, char *filename, const solver_options *opts, uint64_t *nb_sol);
+
+/**
+ * @brief Solve running in the background (see @ref game_solve_async).
+ **/
+typedef struct solve_job_s *solve_job;
+
+/**
+ * @brief Receives the outcome of a solve running in the background, on the thread that ran it.
+ * @param g the game given to @ref game_solve_async, updated like with @ref game_solve_budget
+ * @param status the outcome of the solve
+ * @param user_data the pointer given to @ref game_solve_async
+ **/
+typedef void (*solve_done_callback)(game g, solve_status status, void *user_data);
+
+/**
+ * @brief Solves a given game in the background, on a thread pool shared by all the solves in the background.
+ * @param g the game, which must not be used by the caller before the solve is done
+ * @param opts the options of the solver, copied (their cancel flag is replaced by the one of the job)
+ * @param on_done function called when the solve is done (NULL for none)
+ * @param user_data pointer passed to on_done
+ * @details The pool has one thread per processor, created by the first call. The solves wait for a thread of the
+ * pool in the order of their calls. Every job must be given to @ref game_solve_wait once, which deletes it.
+ * @return the job of the solve
+ **/
+solve_job game_solve_async(game g, const solver_options *opts, solve_done_callback on_done, void *user_data);
+
+/**
+ * @brief Cancels a solve running in the background: a solve still waiting for a thread won't start, a running one
+ * gives up at its next decision. Both end with SOLVE_CANCELLED, leaving the game unchanged.
+ * @param job the job of the solve
+ * @details A solve already done is not changed.
+ **/
+void game_solve_cancel(solve_job job);
+
+/**
+ * @brief Checks whether a solve running in the background is done, without waiting.
+ * @param job the job of the solve
+ * @return true if the solve is done and its on_done callback returned
+ **/
+bool game_solve_poll(solve_job job);
+
+/**
+ * @brief Waits for a solve running in the background to be done, and deletes its job.
+ * @param job the job of the solve (not usable afterwards)
+ * @details Must not be called from the on_done callback of the job.
+ * @return the outcome of the solve
+ **/
+solve_status game_solve_wait(solve_job job);
+
+/**
+ * @}
+ */
+
+#endif  // __GAME_TOOLS_EXT_H__
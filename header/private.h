@@ -213,6 +213,12 @@ bool neigh_get_square(cgame g, uint i, uint j, square s, bool diagadj);
  **/
 uint neigh_count(cgame g, uint i, uint j, square s, bool diag);
 
+/**
+ * @brief Count the number of times the (k, l) square is around (i, j) (more than once, or around itself, on a wrapping
+ * game with less than 3 rows or columns).
+ **/
+uint neigh_count_coor(cgame g, uint i, uint j, uint k, uint l, bool diag);
+
 /**
  * @brief Count the number of valid squares (understand here the number of squares not bordered by the game) around (i, j).
  **/
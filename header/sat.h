@@ -0,0 +1,70 @@
+/**
+ * @file sat.h
+ * @brief Minimal CDCL SAT solver used by the SAT backend of the solver (see solver_sat.c).
+ **/
+
+#ifndef SAT_H
+#define SAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * @brief A literal: 2 * var for the variable itself, 2 * var + 1 for its negation.
+ **/
+#define SAT_LIT(var, positive) (2 * (var) + !(positive))
+
+typedef struct sat_s *sat;
+
+/**
+ * @brief Creates an empty formula.
+ **/
+sat sat_new(void);
+
+/**
+ * @brief Frees the formula and the solver state.
+ **/
+void sat_delete(sat f);
+
+/**
+ * @brief Adds a new variable to the formula and returns it.
+ **/
+uint sat_new_var(sat f);
+
+/**
+ * @brief Adds the clause made of the size literals of lits (the disjunction of the literals).
+ * @return false if the formula is now known to be unsatisfiable
+ **/
+bool sat_add_clause(sat f, const uint *lits, uint size);
+
+/**
+ * @brief Looks for a model of the formula. Clauses may be added between two calls.
+ * @return true if a model was found, false if the formula is unsatisfiable
+ **/
+bool sat_solve(sat f);
+
+/**
+ * @brief Makes sat_solve call interrupted(data) before each decision and return false as soon as it returns true
+ *        (NULL for no check). The formula is left as it was, so that sat_solve can be called again.
+ **/
+void sat_set_interrupt(sat f, bool (*interrupted)(void *data), void *data);
+
+/**
+ * @brief Bytes taken by the clauses of the formula, learned ones included, and their watch lists.
+ **/
+size_t sat_memory(sat f);
+
+/**
+ * @brief Value of a variable in the last model found by sat_solve.
+ **/
+bool sat_model_value(sat f, uint var);
+
+/**
+ * @brief Number of conflicts met by sat_solve since the formula was created.
+ **/
+uint64_t sat_nb_conflicts(sat f);
+
+#endif
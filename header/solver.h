@@ -0,0 +1,395 @@
+/**
+ * @file solver.h
+ * @brief Search engine used by game_tools.c to solve and count the games.
+ **/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "game_tools_ext.h"
+
+/**
+ * @brief Maximum number of trees around a square (and of squares around a tree).
+ **/
+#define MAX_TREES 4
+
+/**
+ * @brief Maximum number of squares in conflict with a tent.
+ **/
+#define MAX_CONF 8
+
+/**
+ * @brief Width of the widest lines whose tent patterns are enumerated (see pattern_table).
+ **/
+#define MAX_PATTERN_WIDTH 20
+
+/**
+ * @brief Value of a square during the search (trees are always SOLVER_GRASS).
+ **/
+typedef enum {
+    SOLVER_UNKNOWN, SOLVER_TENT, SOLVER_GRASS
+} cell_value;
+
+/**
+ * @brief A branching point of the search: the cell, the trail size before it and the branch being explored.
+ **/
+typedef struct decision {
+    uint cell;
+    uint mark;
+    bool second;
+} decision;
+
+/**
+ * @brief Growable list of the learned clauses watching a literal.
+ **/
+typedef struct watch_list {
+    uint *clauses;
+    uint size, capacity;
+} watch_list;
+
+/**
+ * @brief Entry of the component cache: hash and position of the key of a component, and its number of solutions.
+ **/
+typedef struct cache_entry {
+    uint64_t hash, count;
+    uint key, size;
+} cache_entry;
+
+/**
+ * @brief Tent patterns of the lines of a given width: masks of the squares holding a tent, without two tents side by
+ *        side (nor at both ends when the lines wrap around), sorted by number of tents.
+ **/
+typedef struct pattern_table {
+    uint width;
+    uint *masks;
+    uint *first;  // The patterns with k tents are masks[first[k]] to masks[first[k + 1] - 1]
+} pattern_table;
+
+typedef struct solver_s *solver;
+
+/**
+ * @brief Branching heuristic: returns the unknown square to decide next (there is at least one).
+ **/
+typedef uint (*solver_heuristic)(solver s);
+
+/**
+ * @brief Solver structure.
+ * @details Squares are indexed row by row (see get_array_index). The static part describes the neighbourhoods
+ *          of the squares, the dynamic part is updated by every assignment and restored by solver_undo.
+ **/
+typedef struct solver_s {
+    uint nb_rows, nb_cols, nb_cells;
+    bool wrapping, diagadj;
+
+    // Static part
+    uint *row_need, *col_need;      // Expected number of tents per row / column
+    uint nb_trees;
+    uint *tree_cell;                // Square of each tree
+    uint *tree_cand, *tree_nb_cand; // Squares around each tree that may hold a tent (4 per tree)
+    uint *cell_tree, *cell_nb_tree; // Trees around each square (4 per square)
+    uint *cell_conf, *cell_nb_conf; // Squares that can't hold a tent next to a tent on each square (8 per square)
+
+    // Dynamic part
+    cell_value *value;
+    uint *row_tents, *row_free, *col_tents, *col_free;
+    uint *tree_tents, *tree_free;
+    uint nb_free;
+
+    // Trail of assigned squares, also used as the propagation queue
+    uint *trail;
+    uint trail_size, qhead;
+
+    // Decisions of the search
+    decision *decisions;
+    uint depth;
+    solver_heuristic heuristic;
+    uint64_t nb_decisions;
+    uint64_t nb_conflicts;       // Propagations ending in a contradiction
+    uint64_t nb_backtracks;      // Second branches taken, and jumps back of the search looking for one solution
+    int *stop;                   // Flag set by another thread to interrupt the search (NULL if none)
+    const int *cancel;           // Flag set by the caller to give up the search, which then sets stop (NULL if none)
+    bool (*on_solution)(solver s, void *data);  // Called by the search on each solution (NULL if none)
+    void *on_solution_data;      // Passed to on_solution, which returns false to stop the search
+    uint64_t modulus;            // Counts are computed modulo it (0 for 64-bit counts)
+    bool overflow;               // Set when a 64-bit count went over UINT64_MAX
+    double deadline;             // Monotonic time at which a search looking for solutions gives up (0 for none)
+    uint64_t max_decisions;      // Decisions after which it gives up (0 for none)
+    size_t max_memory;           // Bytes of the growing structures beyond which it gives up (0 for none)
+    bool out_of_time, out_of_limits;  // Set when the search gave up for one of the above
+    double count_deadline;       // Monotonic time at which a count (limit 0) gives up (0 for none)
+    bool count_aborted;          // Set when a count gave up at count_deadline: its result is then meaningless
+    progress_callback progress;  // Called every progress_period seconds with the progress of the search (NULL if none)
+    void *progress_data;
+    double progress_period, progress_start, next_report;  // Monotonic times of the start and of the next report
+    uint64_t nb_propagations;    // Squares propagated
+    double progress_done;        // Share of the search tree closed by the component counting
+    double progress_weight;      // Share of the node being counted by it (0 outside of the component counting)
+    uint comp_depth;             // Number of decisions leading to that node
+
+    // Tent patterns of the rows and of the columns (no masks if the lines are wider than MAX_PATTERN_WIDTH)
+    bool use_patterns;
+    pattern_table row_patterns, col_patterns;
+
+    // Failed-literal probing
+    bool probing;
+    uint probe_budget;
+
+    // Nogood learning. A literal is 2 * square + 1 if it stands for grass, 2 * square for a tent. The reason of an
+    // assignment is a record of the reasons array (its number of facts followed by the facts, which are literals).
+    bool learning;
+    uint *level, *reason;        // Decision level and reason record of every square
+    uint *reasons, *reasons_at;  // Records, and their size when each square of the trail was assigned
+    uint reasons_size, reasons_capacity;
+    uint conflict;               // Record of the last contradiction
+    uint *clauses;               // Learned nogoods as clauses: number of literals followed by the literals
+    uint clauses_size, clauses_capacity;
+    watch_list *watches;         // Clauses watching each literal (on their first two literals)
+    uint *learnt, *seen_list;    // Scratch space of the conflict analysis
+    uint learnt_size, learnt_level, nb_seen;
+    bool *seen;
+    uint *tree_pack;             // Line in which each tree was packed by the cover check, plus one
+
+    // Component decomposition when counting: lists of squares (each one preceded by its size) on a stack, and the
+    // component the heuristic chooses from (any square if scope_id is 0)
+    bool components;
+    uint *comp_cells;
+    uint comp_size, comp_capacity;
+    uint *scope, *line_seen;
+    uint scope_id;
+
+    // Component cache: open addressing table (size 0 for a free entry) whose keys are stored one after the other.
+    // The keys only depend on the board, so with keep_cache the entries are kept from one count to the next.
+    bool caching, keep_cache;
+    cache_entry *cache;
+    uint cache_capacity, cache_used;
+    uint *cache_keys, *cache_key;  // Keys, and scratch space of the key being looked up
+    uint keys_size, keys_capacity;
+
+    // Scratch space of the tree cover check (and of the component decomposition)
+    uint *stamp, *line_pack;
+    uint stamp_gen;
+} solver_s;
+
+/**
+ * @brief Creates a solver from a game and the squares that may still hold a tent.
+ * @param g game giving the trees, the expected numbers and the tents already placed
+ * @param candidates game whose TENT squares are the squares left to decide (the others are grass)
+ **/
+solver solver_new(cgame g, cgame candidates);
+
+/**
+ * @brief Current monotonic time in seconds.
+ **/
+double solver_now(void);
+
+/**
+ * @brief Bytes used by the structures of the solver growing with the search: learned nogoods and their watches,
+ *        reasons, component lists and cache.
+ **/
+size_t solver_memory(solver s);
+
+/**
+ * @brief Frees the solver.
+ **/
+void solver_delete(solver s);
+
+/**
+ * @brief Applies the options to the solver.
+ **/
+void solver_set_options(solver s, const solver_options *opts);
+
+/**
+ * @brief Assigns a value to an unknown square as a decision (without reason). Returns false if the square already
+ *        holds another value.
+ **/
+bool solver_assign(solver s, uint cell, cell_value v);
+
+/**
+ * @brief Undoes all the assignments made after the trail had mark elements.
+ **/
+void solver_undo(solver s, uint mark);
+
+/**
+ * @brief Propagates the pending assignments until a fixpoint. Returns false on a contradiction.
+ **/
+bool solver_propagate(solver s);
+
+/**
+ * @brief Forgets the learned nogoods, then checks all the lines and trees and propagates the assignments made so far
+ *        (solver_search starts with it). Returns false on a contradiction.
+ **/
+bool solver_prepare(solver s);
+
+/**
+ * @brief Same as solver_prepare, but keeps the learned nogoods and propagates them too, and probes when probing is
+ *        enabled: after a search given up, the solver gets the facts that search proved at its root. The nogoods must
+ *        have been learned by a search started from the same assignments (not within a cube). Returns false on a
+ *        contradiction.
+ **/
+bool solver_prepare_learnt(solver s);
+
+/**
+ * @brief Probes every unknown square (see solver_options). Returns false on a contradiction.
+ **/
+bool solver_probe(solver s);
+
+/**
+ * @brief Heuristic deciding the first unknown square (row by row).
+ **/
+uint solver_choose_first(solver s);
+
+/**
+ * @brief Default heuristic: most constrained tree or line first (see solver.c).
+ **/
+uint solver_choose_mrv(solver s);
+
+/**
+ * @brief Sum and product of two numbers of solutions, modulo the modulus of the solver when it has one. Without
+ *        modulus, a result over UINT64_MAX sets the overflow flag of the solver and is replaced by UINT64_MAX.
+ **/
+uint64_t solver_count_add(solver s, uint64_t a, uint64_t b);
+uint64_t solver_count_mul(solver s, uint64_t a, uint64_t b);
+
+/**
+ * @brief Empties the component cache (counts kept with keep_cache are then forgotten).
+ **/
+void solver_clear_cache(solver s);
+
+/**
+ * @brief Whether a search looking for solutions has to stop: stop flag set by another thread, cancel flag set, or
+ *        budget of the solver run out, which sets out_of_time or out_of_limits. The last two set the stop flag for the
+ *        other threads. The clock and the memory are only checked every 64 decisions.
+ **/
+bool solver_interrupted(solver s);
+
+/**
+ * @brief Explores the search tree and counts the solutions.
+ * @details Stops as soon as limit solutions are found (0 means no limit) and leaves the solver on the last
+ *          solution found in that case. Otherwise the solver is restored to its initial state. A search looking for
+ *          solutions (limit != 0) also stops when the stop flag of the solver is set, or when its budget runs out
+ *          (which sets out_of_time or out_of_limits, and the stop flag for the other threads). Each solution is
+ *          passed to on_solution when the solver has one, and the search stops if it returns false (the components
+ *          are not used then, so that every solution is met). A count (limit 0) gives up at count_deadline, which
+ *          sets count_aborted.
+ * @return the number of solutions found
+ **/
+uint64_t solver_search(solver s, uint64_t limit);
+
+/**
+ * @brief Leaves the solver on a solution drawn uniformly at random among all its solutions (see solver.c).
+ * @details The draw is exact as long as the numbers of solutions of the components fit in 64 bits. The solver must
+ *          have no modulus.
+ * @param rng state of the random generator, advanced by the draw
+ * @return false if there is no solution (the solver is then restored)
+ **/
+bool solver_sample(solver s, uint64_t *rng);
+
+/**
+ * @brief Draws a number uniformly below n (n > 0) and advances the state rng of the random generator.
+ **/
+uint64_t solver_random(uint64_t *rng, uint64_t n);
+
+/**
+ * @brief Makes one probe of the estimator of the number of solutions: a random path down the search tree, whose
+ *        estimates have the number of solutions as mean (see solver.c). The cache of the components is kept from one
+ *        probe to the next. The solver must have no modulus, and is restored afterwards.
+ * @param rng state of the random generator, advanced by the probe
+ * @return the base 2 logarithm of the estimate, or -1 for an estimate of 0
+ **/
+double solver_estimate(solver s, uint64_t *rng);
+
+/**
+ * @brief Same as solver_search with the SAT backend: the unknown squares are encoded into a formula solved by the
+ *        CDCL core of sat.c (see solver_sat.c).
+ **/
+uint64_t solver_sat_search(solver s, uint64_t limit);
+
+/**
+ * @brief Same as solver_search with the dancing links backend: the unknown squares are options covering the rows, the
+ *        columns and the trees (see solver_dlx.c).
+ **/
+uint64_t solver_dlx_search(solver s, uint64_t limit);
+
+/**
+ * @brief A search function of one of the backends (solver_search, solver_sat_search or solver_dlx_search).
+ **/
+typedef uint64_t (*solver_search_fn)(solver s, uint64_t limit);
+
+/**
+ * @brief Counts the solutions with several threads, one per solver of workers (see solver_parallel.c).
+ * @param workers solvers in the same state, each one with the same options
+ * @return the number of solutions (the solvers are restored to their state, and the first one gets the overflow flag
+ *         if the count of any of them overflowed)
+ **/
+uint64_t solver_parallel_count(solver *workers, uint nb_workers);
+
+/**
+ * @brief Looks for a solution with several threads, one per solver of workers, each one searching its own parts of
+ *        the search tree until one of them finds a solution (see solver_parallel.c).
+ * @param workers solvers in the same state, each one with the same options
+ * @return the index of the solver left on the solution found (the others are restored), or -1 if there is none or if
+ *         a worker ran out of its budget first
+ **/
+int solver_parallel_solve(solver *workers, uint nb_workers);
+
+/**
+ * @brief Receives a cube: the nb_lits decisions leading to a node of the search tree, as literals (2 * square + 1 for
+ *        grass, 2 * square for a tent).
+ * @return false if the cube couldn't be kept (the split then stops)
+ **/
+typedef bool (*solver_cube_fn)(const uint *lits, uint nb_lits, void *data);
+
+/**
+ * @brief Cuts the search tree into cubes of at most max_depth decisions taken by the heuristic, and passes each one to
+ *        emit with data (see solver_parallel.c). The branches found inconsistent by propagation give no cube, so that
+ *        the solutions are the disjoint union of the solutions of the cubes.
+ * @param nb_cubes receives the number of cubes kept by emit
+ * @return false if emit failed to keep a cube, the cubes after it being left out
+ **/
+bool solver_split(solver s, uint max_depth, solver_cube_fn emit, void *data, uint *nb_cubes);
+
+/**
+ * @brief Looks for a solution with several engines racing on their own threads: the first engine answering (solution
+ *        found or none exists) stops the others (see solver_parallel.c).
+ * @param engines solvers in the same state, each one with the options of its engine
+ * @param searches search function of each engine
+ * @param found receives whether the winning engine found a solution
+ * @return the index of the engine that answered first; its solver is left on the solution found. -1 if a native
+ *         engine ran out of its budget before any answer.
+ **/
+int solver_portfolio_solve(solver *engines, const solver_search_fn *searches, uint nb_engines, bool *found);
+
+/**
+ * @brief Counts the solutions by dynamic programming over the lines of the smaller side of the board (see solver_dp.c).
+ *        The state kept between two lines holds the number of tents of every crossing line, so there are up to about
+ *        (length / 2)^width states: polynomial in the length, with the width as degree. Long boards are only
+ *        counted when 2 to 4 squares wide; the count gives up beyond MAX_STATES states (e.g. 8x1000 or 4x4000).
+ * @param max_width the count is only done if the smaller side has at most max_width squares
+ * @param nb_sol receives the number of solutions
+ * @return false if the count was not done (board too wide, or too many states to keep between two lines)
+ **/
+bool solver_dp_count(solver s, uint max_width, uint64_t *nb_sol);
+
+/**
+ * @brief Same as solver_sample with the dynamic programming of solver_dp_count: the tables of all the lines are kept
+ *        to draw the lines back from the last one (see solver_dp.c).
+ * @param found receives whether there is a solution (the solver is then left on the solution drawn)
+ * @return false if the draw was not done (same cases as solver_dp_count)
+ **/
+bool solver_dp_sample(solver s, uint max_width, uint64_t *rng, bool *found);
+
+/**
+ * @brief Copies the tents of a fully assigned solver into g (other squares that are not trees become EMPTY).
+ **/
+void solver_export(solver s, game g);
+
+/**
+ * @brief Copies the squares decided in the solver into g: tents, grass, and EMPTY for the squares still unknown.
+ **/
+void solver_export_partial(solver s, game g);
+
+#endif
@@ -1,6 +1,7 @@
 #include "header/private.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -200,6 +201,37 @@ uint neigh_count(cgame g, uint i, uint j, square s, bool diag) {
     return cpt;
 }
 
+// Whether the square in the dir direction of (i, j) is the (k, l) square
+static bool neigh_is_coor(cgame g, uint i, uint j, direction dir, uint k, uint l) {
+    coor new = coor_to_dir(i, j, dir);
+    uint new_i = row_of_coor(new);
+    uint new_j = col_of_coor(new);
+
+    if (game_is_wrapping(g)) {
+        new_i = (new_i + game_nb_rows(g)) % game_nb_rows(g);
+        new_j = (new_j + game_nb_cols(g)) % game_nb_cols(g);
+    }
+    return check_coor(g, new_i, new_j) && new_i == k && new_j == l;
+}
+
+uint neigh_count_coor(cgame g, uint i, uint j, uint k, uint l, bool diag) {
+    uint cpt = 0;
+
+    if (neigh_is_coor(g, i, j, WEST, k, l)) cpt++;
+    if (neigh_is_coor(g, i, j, EAST, k, l)) cpt++;
+    if (neigh_is_coor(g, i, j, SOUTH, k, l)) cpt++;
+    if (neigh_is_coor(g, i, j, NORTH, k, l)) cpt++;
+
+    if (diag) {
+        if (neigh_is_coor(g, i, j, NORTH_WEST, k, l)) cpt++;
+        if (neigh_is_coor(g, i, j, NORTH_EAST, k, l)) cpt++;
+        if (neigh_is_coor(g, i, j, SOUTH_WEST, k, l)) cpt++;
+        if (neigh_is_coor(g, i, j, SOUTH_EAST, k, l)) cpt++;
+    }
+
+    return cpt;
+}
+
 uint neigh_count_valid(cgame g, int i, int j) {
     if (game_is_wrapping(g))
         return 4;
@@ -354,23 +386,38 @@ move make_move(cgame g, uint i, uint j, square s) {
 /*                             CREATE RANDOM GAME                             */
 /* ************************************************************************** */
 
-static void place_random_tree(game g, uint i, uint j) {
-    uint rdm = (rand() % 3) + 1;
+/* The random numbers come from a splitmix64 generator local to each call, instead of rand and srand whose state is
+ * shared by the whole process, so that games can be generated by several threads at once. Its seed mixes the time
+ * with a counter of the calls, so that two calls in the same second give different games.
+ */
+
+static uint64_t nb_generated = 0;  // Calls to generate_random (incremented atomically)
+
+// Random number below n, advancing the state of the generator
+static uint random_below(uint64_t *state, uint n) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) % n;
+}
+
+static void place_random_tree(game g, uint i, uint j, uint64_t *state) {
+    uint rdm = random_below(state, 3) + 1;
     bool tent_placed = true;
 
     while (tent_placed) {
         if (neigh_check_square(g, i, j, rdm, EMPTY))
             if (neigh_set_square(g, i, j, rdm, TREE))
                 tent_placed = false;
-        rdm = (rand() % 3) + 1;
+        rdm = random_below(state, 3) + 1;
     }
 }
 
 game generate_random(uint nb_rows, uint nb_cols, uint tree_to_place, bool wrapping, bool diagadj) {
     game g = game_new_empty_ext(nb_rows, nb_cols, wrapping, diagadj);
 
-    srand(time(NULL));
-    uint rdm = rand() % (nb_rows + nb_cols);
+    uint64_t state = (uint64_t)time(NULL) ^ (__atomic_fetch_add(&nb_generated, 1, __ATOMIC_RELAXED) << 32);
+    uint rdm = random_below(&state, nb_rows + nb_cols);
 
     while (tree_to_place != nb_square_all(g, TENT)) {
         for (uint i = 0; i < nb_rows; i++) {
@@ -384,7 +431,7 @@ game generate_random(uint nb_rows, uint nb_cols, uint tree_to_place, bool wrappi
                         }
                     }
                 }
-                rdm = rand() % (nb_rows + nb_cols);
+                rdm = random_below(&state, nb_rows + nb_cols);
             }
         }
     }
@@ -392,7 +439,7 @@ game generate_random(uint nb_rows, uint nb_cols, uint tree_to_place, bool wrappi
     for (uint i = 0; i < nb_rows; i++)
         for (uint j = 0; j < nb_cols; j++)
             if (check_square_tent(g, i, j)) {
-                place_random_tree(g, i, j);
+                place_random_tree(g, i, j, &state);
                 game_set_square(g, i, j, EMPTY);
             }
 
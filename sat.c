@@ -0,0 +1,461 @@
+#include "header/sat.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_CLAUSE UINT32_MAX
+#define NOT_IN_HEAP UINT32_MAX
+#define VAR_DECAY 0.95
+#define RESTART_BASE 100  // Conflicts of the first restart interval (the following ones follow the Luby sequence)
+
+// Growable list of the clauses watching a literal
+typedef struct watchers {
+    uint *clauses;
+    uint size, capacity;
+} watchers;
+
+/* The solver is a plain CDCL loop: unit propagation with two watched literals, first-UIP learning, VSIDS branching
+ * with phase saving and Luby restarts. Learned clauses are never deleted, the formulas built from the puzzles being
+ * small. Clauses live in one array: the number of literals followed by the literals, the watched ones first.
+ */
+typedef struct sat_s {
+    uint nb_vars, vars_capacity;
+    bool ok;  // False once the formula is known to be unsatisfiable
+
+    uint *clauses;
+    uint clauses_size, clauses_capacity;
+    watchers *watches;  // Clauses watching each literal
+
+    // Assignment
+    signed char *value;  // 1 true, -1 false, 0 unknown
+    uint *level, *reason;
+    bool *phase, *model, *seen;
+    uint *trail, *trail_lim;  // Assigned literals, and trail size at the start of each decision level
+    uint trail_size, nb_levels, qhead;
+
+    // Branching
+    double *activity;
+    double var_inc;
+    uint *heap, *heap_pos;
+    uint heap_size;
+
+    uint *learnt;
+    uint64_t nb_conflicts;
+    bool (*interrupted)(void *data);  // Polled before each decision to interrupt sat_solve (NULL if none)
+    void *data;
+} sat_s;
+
+/* ************************************************************************** */
+/*                              CREATE / DELETE                               */
+/* ************************************************************************** */
+
+sat sat_new(void) {
+    sat f = calloc(1, sizeof(sat_s));
+    assert(f);
+    f->ok = true;
+    f->clauses_capacity = 1024;
+    f->clauses = malloc(f->clauses_capacity * sizeof(uint));
+    assert(f->clauses);
+    f->var_inc = 1.0;
+    return f;
+}
+
+void sat_delete(sat f) {
+    assert(f);
+    for (uint l = 0; l < 2 * f->nb_vars; l++)
+        free(f->watches[l].clauses);
+    free(f->watches);
+    free(f->clauses);
+    free(f->value);
+    free(f->level);
+    free(f->reason);
+    free(f->phase);
+    free(f->model);
+    free(f->seen);
+    free(f->trail);
+    free(f->trail_lim);
+    free(f->activity);
+    free(f->heap);
+    free(f->heap_pos);
+    free(f->learnt);
+    free(f);
+}
+
+/* ************************************************************************** */
+/*                                   HEAP                                     */
+/* ************************************************************************** */
+
+// Moves the variable at position k of the heap up to its place (highest activity at the root)
+static void heap_up(sat f, uint k) {
+    uint var = f->heap[k];
+    while (k > 0 && f->activity[f->heap[(k - 1) / 2]] < f->activity[var]) {
+        f->heap[k] = f->heap[(k - 1) / 2];
+        f->heap_pos[f->heap[k]] = k;
+        k = (k - 1) / 2;
+    }
+    f->heap[k] = var;
+    f->heap_pos[var] = k;
+}
+
+// Moves the variable at position k of the heap down to its place
+static void heap_down(sat f, uint k) {
+    uint var = f->heap[k];
+    while (2 * k + 1 < f->heap_size) {
+        uint child = 2 * k + 1;
+        if (child + 1 < f->heap_size && f->activity[f->heap[child + 1]] > f->activity[f->heap[child]])
+            child++;
+        if (f->activity[f->heap[child]] <= f->activity[var])
+            break;
+        f->heap[k] = f->heap[child];
+        f->heap_pos[f->heap[k]] = k;
+        k = child;
+    }
+    f->heap[k] = var;
+    f->heap_pos[var] = k;
+}
+
+static void heap_insert(sat f, uint var) {
+    if (f->heap_pos[var] != NOT_IN_HEAP)
+        return;
+    f->heap[f->heap_size] = var;
+    heap_up(f, f->heap_size++);
+}
+
+static uint heap_pop(sat f) {
+    uint var = f->heap[0];
+    f->heap_pos[var] = NOT_IN_HEAP;
+    if (--f->heap_size > 0) {
+        f->heap[0] = f->heap[f->heap_size];
+        heap_down(f, 0);
+    }
+    return var;
+}
+
+// Bumps the activity of a variable met by the conflict analysis
+static void bump(sat f, uint var) {
+    if ((f->activity[var] += f->var_inc) > 1e100) {
+        for (uint v = 0; v < f->nb_vars; v++)
+            f->activity[v] *= 1e-100;
+        f->var_inc *= 1e-100;
+    }
+    if (f->heap_pos[var] != NOT_IN_HEAP)
+        heap_up(f, f->heap_pos[var]);
+}
+
+/* ************************************************************************** */
+/*                                 VARIABLES                                  */
+/* ************************************************************************** */
+
+#define GROW(array, capacity) ((array) = realloc((array), (capacity) * sizeof(*(array))), assert(array))
+
+uint sat_new_var(sat f) {
+    assert(f);
+    if (f->nb_vars == f->vars_capacity) {
+        uint old = f->vars_capacity;
+        f->vars_capacity = 2 * old + 16;
+        GROW(f->value, f->vars_capacity);
+        GROW(f->level, f->vars_capacity);
+        GROW(f->reason, f->vars_capacity);
+        GROW(f->phase, f->vars_capacity);
+        GROW(f->model, f->vars_capacity);
+        GROW(f->seen, f->vars_capacity);
+        GROW(f->trail, f->vars_capacity);
+        GROW(f->trail_lim, f->vars_capacity);
+        GROW(f->activity, f->vars_capacity);
+        GROW(f->heap, f->vars_capacity);
+        GROW(f->heap_pos, f->vars_capacity);
+        GROW(f->learnt, f->vars_capacity);
+        GROW(f->watches, 2 * f->vars_capacity);
+        memset(f->watches + 2 * old, 0, 2 * (f->vars_capacity - old) * sizeof(watchers));
+    }
+    uint var = f->nb_vars++;
+    f->value[var] = 0;
+    f->level[var] = 0;
+    f->reason[var] = NO_CLAUSE;
+    f->phase[var] = false;  // Most squares of a solution are grass
+    f->model[var] = false;
+    f->seen[var] = false;
+    f->activity[var] = 0.0;
+    f->heap_pos[var] = NOT_IN_HEAP;
+    heap_insert(f, var);
+    return var;
+}
+
+// Value of a literal: 1 true, -1 false, 0 unknown
+static int lit_value(sat f, uint lit) {
+    int v = f->value[lit >> 1];
+    return (lit & 1) ? -v : v;
+}
+
+static void assign(sat f, uint lit, uint reason) {
+    uint var = lit >> 1;
+    f->value[var] = (lit & 1) ? -1 : 1;
+    f->level[var] = f->nb_levels;
+    f->reason[var] = reason;
+    f->trail[f->trail_size++] = lit;
+}
+
+// Undoes the assignments of the levels above lvl
+static void backtrack(sat f, uint lvl) {
+    if (f->nb_levels <= lvl)
+        return;
+    for (uint k = f->trail_size; k > f->trail_lim[lvl]; k--) {
+        uint var = f->trail[k - 1] >> 1;
+        f->phase[var] = f->value[var] > 0;
+        f->value[var] = 0;
+        heap_insert(f, var);
+    }
+    f->trail_size = f->qhead = f->trail_lim[lvl];
+    f->nb_levels = lvl;
+}
+
+/* ************************************************************************** */
+/*                                  CLAUSES                                   */
+/* ************************************************************************** */
+
+static void watch(sat f, uint lit, uint cl) {
+    watchers *w = &f->watches[lit];
+    if (w->size == w->capacity) {
+        w->capacity = 2 * w->capacity + 4;
+        GROW(w->clauses, w->capacity);
+    }
+    w->clauses[w->size++] = cl;
+}
+
+// Stores a clause of at least two literals and watches its first two literals
+static uint store_clause(sat f, const uint *lits, uint size) {
+    if (f->clauses_size + size + 1 > f->clauses_capacity) {
+        f->clauses_capacity = 2 * f->clauses_capacity + size + 1;
+        GROW(f->clauses, f->clauses_capacity);
+    }
+    uint cl = f->clauses_size;
+    f->clauses[f->clauses_size++] = size;
+    memcpy(&f->clauses[f->clauses_size], lits, size * sizeof(uint));
+    f->clauses_size += size;
+    watch(f, lits[0], cl);
+    watch(f, lits[1], cl);
+    return cl;
+}
+
+// Propagates the assignments of the trail. Returns the clause in conflict, or NO_CLAUSE.
+static uint propagate(sat f) {
+    while (f->qhead < f->trail_size) {
+        uint false_lit = f->trail[f->qhead++] ^ 1;
+        watchers *w = &f->watches[false_lit];
+        uint i = 0, j = 0;
+
+        while (i < w->size) {
+            uint cl = w->clauses[i++];
+            uint size = f->clauses[cl];
+            uint *lits = &f->clauses[cl + 1];
+            if (lits[0] == false_lit) {  // The false literal goes second
+                lits[0] = lits[1];
+                lits[1] = false_lit;
+            }
+            if (lit_value(f, lits[0]) == 1) {
+                w->clauses[j++] = cl;
+                continue;
+            }
+
+            bool moved = false;
+            for (uint k = 2; k < size && !moved; k++)
+                if (lit_value(f, lits[k]) != -1) {
+                    lits[1] = lits[k];
+                    lits[k] = false_lit;
+                    watch(f, lits[1], cl);
+                    moved = true;
+                }
+            if (moved)
+                continue;
+
+            w->clauses[j++] = cl;
+            if (lit_value(f, lits[0]) == -1) {  // Conflict: the remaining watchers are kept
+                while (i < w->size)
+                    w->clauses[j++] = w->clauses[i++];
+                w->size = j;
+                return cl;
+            }
+            assign(f, lits[0], cl);
+        }
+        w->size = j;
+    }
+    return NO_CLAUSE;
+}
+
+bool sat_add_clause(sat f, const uint *lits, uint size) {
+    assert(f && (lits || size == 0));
+    if (!f->ok)
+        return false;
+    backtrack(f, 0);
+
+    // Drops the literals false at level 0, and the clause if it is already satisfied or a tautology
+    uint *kept = f->learnt, nb = 0;
+    bool satisfied = false;
+    for (uint k = 0; k < size && !satisfied; k++) {
+        assert((lits[k] >> 1) < f->nb_vars);
+        int v = lit_value(f, lits[k]);
+        if (v == 1)
+            satisfied = true;
+        else if (v == 0 && !f->seen[lits[k] >> 1]) {
+            f->seen[lits[k] >> 1] = true;
+            kept[nb++] = lits[k];
+        } else if (v == 0)  // The variable appears twice: a duplicate, or a tautology
+            for (uint m = 0; m < nb; m++)
+                satisfied |= kept[m] == (lits[k] ^ 1);
+    }
+    for (uint k = 0; k < nb; k++)
+        f->seen[kept[k] >> 1] = false;
+    if (satisfied)
+        return true;
+
+    if (nb == 0)
+        f->ok = false;
+    else if (nb == 1) {
+        assign(f, kept[0], NO_CLAUSE);
+        f->ok = propagate(f) == NO_CLAUSE;
+    } else
+        store_clause(f, kept, nb);
+    return f->ok;
+}
+
+/* ************************************************************************** */
+/*                                  SEARCH                                    */
+/* ************************************************************************** */
+
+// Marks a literal of a clause met by the analysis: the literals of the current level are counted in pending, the
+// others go to the learned clause
+static void analyze_lit(sat f, uint lit, uint *pending, uint *size) {
+    uint var = lit >> 1;
+    if (f->seen[var] || f->level[var] == 0)
+        return;
+    f->seen[var] = true;
+    bump(f, var);
+    if (f->level[var] == f->nb_levels)
+        (*pending)++;
+    else
+        f->learnt[(*size)++] = lit;
+}
+
+/* Explains the conflict of clause cl up to the first unique implication point. The learned clause goes to learnt (the
+ * negation of the unique implication point first, then the literal of highest level). Returns its size.
+ */
+static uint analyze(sat f, uint cl, uint *bt_level) {
+    uint pending = 0, size = 1, index = f->trail_size;
+    uint lit = UINT32_MAX;
+    do {
+        for (uint k = 0; k < f->clauses[cl]; k++)
+            if (f->clauses[cl + 1 + k] != lit)
+                analyze_lit(f, f->clauses[cl + 1 + k], &pending, &size);
+        do
+            lit = f->trail[--index];
+        while (!f->seen[lit >> 1]);
+        f->seen[lit >> 1] = false;
+        cl = f->reason[lit >> 1];
+    } while (--pending > 0);
+    f->learnt[0] = lit ^ 1;
+
+    *bt_level = 0;
+    for (uint k = 1; k < size; k++) {
+        f->seen[f->learnt[k] >> 1] = false;
+        if (f->level[f->learnt[k] >> 1] > *bt_level) {
+            *bt_level = f->level[f->learnt[k] >> 1];
+            uint tmp = f->learnt[1];
+            f->learnt[1] = f->learnt[k];
+            f->learnt[k] = tmp;
+        }
+    }
+    return size;
+}
+
+// Element i of the Luby sequence 1, 1, 2, 1, 1, 2, 4, ...
+static uint luby(uint i) {
+    uint size = 1, seq = 0;
+    while (size < i + 1) {
+        seq++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) / 2;
+        seq--;
+        i %= size;
+    }
+    return 1u << seq;
+}
+
+bool sat_solve(sat f) {
+    assert(f);
+    if (!f->ok)
+        return false;
+    backtrack(f, 0);
+    if (propagate(f) != NO_CLAUSE)
+        return f->ok = false;
+
+    uint restarts = 0;
+    uint64_t restart_at = f->nb_conflicts + RESTART_BASE * luby(restarts);
+    while (true) {
+        uint cl = propagate(f);
+        if (cl != NO_CLAUSE) {
+            f->nb_conflicts++;
+            if (f->nb_levels == 0)
+                return f->ok = false;
+            uint bt_level;
+            uint size = analyze(f, cl, &bt_level);
+            backtrack(f, bt_level);
+            if (size == 1)
+                assign(f, f->learnt[0], NO_CLAUSE);
+            else
+                assign(f, f->learnt[0], store_clause(f, f->learnt, size));
+            f->var_inc /= VAR_DECAY;
+            continue;
+        }
+
+        if (f->interrupted != NULL && f->interrupted(f->data)) {
+            backtrack(f, 0);
+            return false;
+        }
+        if (f->nb_conflicts >= restart_at) {
+            backtrack(f, 0);
+            restart_at = f->nb_conflicts + RESTART_BASE * luby(++restarts);
+        }
+
+        uint var = UINT32_MAX;
+        while (f->heap_size > 0 && var == UINT32_MAX) {
+            var = heap_pop(f);
+            if (f->value[var] != 0)
+                var = UINT32_MAX;
+        }
+        if (var == UINT32_MAX) {  // Every variable is assigned: this is a model
+            for (uint v = 0; v < f->nb_vars; v++)
+                f->model[v] = f->value[v] > 0;
+            return true;
+        }
+        f->trail_lim[f->nb_levels++] = f->trail_size;
+        assign(f, SAT_LIT(var, f->phase[var]), NO_CLAUSE);
+    }
+}
+
+bool sat_model_value(sat f, uint var) {
+    assert(f && var < f->nb_vars);
+    return f->model[var];
+}
+
+void sat_set_interrupt(sat f, bool (*interrupted)(void *data), void *data) {
+    assert(f);
+    f->interrupted = interrupted;
+    f->data = data;
+}
+
+size_t sat_memory(sat f) {
+    assert(f);
+    size_t bytes = (size_t)f->clauses_capacity * sizeof(uint);
+    for (uint l = 0; l < 2 * f->nb_vars; l++)
+        bytes += (size_t)f->watches[l].capacity * sizeof(uint);
+    return bytes;
+}
+
+uint64_t sat_nb_conflicts(sat f) {
+    assert(f);
+    return f->nb_conflicts;
+}
@@ -0,0 +1,1821 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "header/solver.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "header/game.h"
+#include "header/game_ext.h"
+#include "header/private.h"
+
+#define NO_REASON UINT32_MAX
+#define MAX_CLAUSES_SIZE (1u << 22)  // Size of the learned clauses above which no more nogood is kept
+#define MAX_COUNTING_NOGOOD 8        // Longest nogood kept when counting (longer ones seldom cut a subtree)
+
+/* ************************************************************************** */
+/*                              CREATE / DELETE                               */
+/* ************************************************************************** */
+
+// Gets the index of the square in the dir direction of (i, j), following the rules of neigh_check_square
+static bool neigh_cell(cgame g, uint i, uint j, direction dir, uint *cell) {
+    coor new = coor_to_dir(i, j, dir);
+    uint new_i = row_of_coor(new);
+    uint new_j = col_of_coor(new);
+
+    if (game_is_wrapping(g)) {
+        new_i = (new_i + game_nb_rows(g)) % game_nb_rows(g);
+        new_j = (new_j + game_nb_cols(g)) % game_nb_cols(g);
+    }
+    if (!check_coor(g, new_i, new_j))
+        return false;
+    *cell = get_array_index(g, new_i, new_j);
+    return true;
+}
+
+// Adds cell to the list (of stride size) if it is not there yet
+static void add_unique(uint *list, uint *nb, uint cell) {
+    for (uint k = 0; k < *nb; k++)
+        if (list[k] == cell)
+            return;
+    list[(*nb)++] = cell;
+}
+
+// Computes the neighbourhoods of every square and every tree
+static void build_neighbourhoods(solver s, cgame g) {
+    direction orth[] = {NORTH, SOUTH, WEST, EAST};
+    direction diag[] = {NORTH_WEST, NORTH_EAST, SOUTH_WEST, SOUTH_EAST};
+    uint *tree_index = malloc(s->nb_cells * sizeof(uint));
+    assert(tree_index);
+
+    s->nb_trees = 0;
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (check_square_tree(g, c / s->nb_cols, c % s->nb_cols)) {
+            tree_index[c] = s->nb_trees;
+            s->tree_cell[s->nb_trees++] = c;
+        }
+
+    for (uint c = 0; c < s->nb_cells; c++) {
+        uint i = c / s->nb_cols, j = c % s->nb_cols, n = 0;
+        for (uint d = 0; d < 4; d++)
+            if (neigh_cell(g, i, j, orth[d], &n)) {
+                add_unique(&s->cell_conf[c * MAX_CONF], &s->cell_nb_conf[c], n);
+                if (check_square_tree(g, n / s->nb_cols, n % s->nb_cols) && !check_square_tree(g, i, j)) {
+                    uint t = tree_index[n];
+                    add_unique(&s->cell_tree[c * MAX_TREES], &s->cell_nb_tree[c], t);
+                    add_unique(&s->tree_cand[t * MAX_TREES], &s->tree_nb_cand[t], c);
+                }
+            }
+        if (!s->diagadj)  // Tents can't touch each other diagonally either
+            for (uint d = 0; d < 4; d++)
+                if (neigh_cell(g, i, j, diag[d], &n))
+                    add_unique(&s->cell_conf[c * MAX_CONF], &s->cell_nb_conf[c], n);
+    }
+    free(tree_index);
+}
+
+static uint popcount(uint x) {
+    uint n = 0;
+    for (; x != 0; x &= x - 1)
+        n++;
+    return n;
+}
+
+// Adds to masks (if not NULL) the patterns of the squares pos and after, the squares before holding mask and the last
+// one a tent if last. Returns the new number of patterns.
+static uint add_patterns(uint *masks, uint nb, uint width, bool cyclic, uint pos, uint mask, bool last) {
+    if (pos == width) {
+        if (cyclic && last && (mask & 1))  // Both ends are side by side when the line wraps around
+            return nb;
+        if (masks)
+            masks[nb] = mask;
+        return nb + 1;
+    }
+    nb = add_patterns(masks, nb, width, cyclic, pos + 1, mask, false);
+    if (!last && !(cyclic && width == 1))  // A single square wrapping around is next to itself
+        nb = add_patterns(masks, nb, width, cyclic, pos + 1, mask | 1u << pos, true);
+    return nb;
+}
+
+// Enumerates the tent patterns of the lines of the given width, sorted by number of tents
+static void build_patterns(pattern_table *t, uint width, bool cyclic) {
+    t->width = width;
+    t->masks = NULL;
+    t->first = NULL;
+    if (width > MAX_PATTERN_WIDTH)
+        return;
+    uint nb = add_patterns(NULL, 0, width, cyclic, 0, 0, false);
+    uint *all = malloc(nb * sizeof(uint));
+    t->masks = malloc(nb * sizeof(uint));
+    t->first = calloc(width + 2, sizeof(uint));
+    assert(all && t->masks && t->first);
+    add_patterns(all, 0, width, cyclic, 0, 0, false);
+
+    for (uint k = 0; k < nb; k++)  // Counting sort on the number of tents
+        t->first[popcount(all[k]) + 1]++;
+    for (uint k = 1; k <= width + 1; k++)
+        t->first[k] += t->first[k - 1];
+    uint *next = malloc((width + 1) * sizeof(uint));
+    assert(next);
+    memcpy(next, t->first, (width + 1) * sizeof(uint));
+    for (uint k = 0; k < nb; k++)
+        t->masks[next[popcount(all[k])]++] = all[k];
+    free(next);
+    free(all);
+}
+
+solver solver_new(cgame g, cgame candidates) {
+    assert(g && candidates);
+    solver s = malloc(sizeof(solver_s));
+    assert(s);
+
+    s->nb_rows = game_nb_rows(g);
+    s->nb_cols = game_nb_cols(g);
+    s->nb_cells = s->nb_rows * s->nb_cols;
+    s->wrapping = game_is_wrapping(g);
+    s->diagadj = game_is_diagadj(g);
+
+    s->row_need = malloc(s->nb_rows * sizeof(uint));
+    s->col_need = malloc(s->nb_cols * sizeof(uint));
+    s->tree_cell = malloc(s->nb_cells * sizeof(uint));
+    s->tree_cand = malloc(s->nb_cells * MAX_TREES * sizeof(uint));
+    s->tree_nb_cand = calloc(s->nb_cells, sizeof(uint));
+    s->cell_tree = malloc(s->nb_cells * MAX_TREES * sizeof(uint));
+    s->cell_nb_tree = calloc(s->nb_cells, sizeof(uint));
+    s->cell_conf = malloc(s->nb_cells * MAX_CONF * sizeof(uint));
+    s->cell_nb_conf = calloc(s->nb_cells, sizeof(uint));
+    s->value = malloc(s->nb_cells * sizeof(cell_value));
+    s->row_tents = calloc(s->nb_rows, sizeof(uint));
+    s->row_free = calloc(s->nb_rows, sizeof(uint));
+    s->col_tents = calloc(s->nb_cols, sizeof(uint));
+    s->col_free = calloc(s->nb_cols, sizeof(uint));
+    s->tree_tents = calloc(s->nb_cells, sizeof(uint));
+    s->tree_free = calloc(s->nb_cells, sizeof(uint));
+    s->trail = malloc(s->nb_cells * sizeof(uint));
+    s->decisions = malloc(s->nb_cells * sizeof(decision));
+    s->stamp = calloc(s->nb_cells, sizeof(uint));
+    s->line_pack = malloc((s->nb_rows > s->nb_cols ? s->nb_rows : s->nb_cols) * sizeof(uint));
+    s->level = calloc(s->nb_cells, sizeof(uint));
+    s->reason = malloc(s->nb_cells * sizeof(uint));
+    s->reasons_at = malloc(s->nb_cells * sizeof(uint));
+    s->reasons_capacity = 1024;
+    s->reasons = malloc(s->reasons_capacity * sizeof(uint));
+    s->clauses_capacity = 1024;
+    s->clauses = malloc(s->clauses_capacity * sizeof(uint));
+    s->watches = calloc(2 * s->nb_cells, sizeof(watch_list));
+    s->learnt = malloc(s->nb_cells * sizeof(uint));
+    s->seen_list = malloc(s->nb_cells * sizeof(uint));
+    s->seen = calloc(s->nb_cells, sizeof(bool));
+    s->tree_pack = calloc(s->nb_cells, sizeof(uint));
+    s->comp_capacity = 2 * s->nb_cells + 2;
+    s->comp_cells = malloc(s->comp_capacity * sizeof(uint));
+    s->scope = calloc(s->nb_cells, sizeof(uint));
+    s->line_seen = calloc(s->nb_rows + s->nb_cols, sizeof(uint));
+    s->cache_capacity = 1024;
+    s->cache = calloc(s->cache_capacity, sizeof(cache_entry));
+    s->keys_capacity = 4096;
+    s->cache_keys = malloc(s->keys_capacity * sizeof(uint));
+    s->cache_key = malloc(4 * s->nb_cells * sizeof(uint));
+
+    assert(s->row_need && s->col_need && s->tree_cell && s->tree_cand && s->tree_nb_cand && s->cell_tree);
+    assert(s->cell_nb_tree && s->cell_conf && s->cell_nb_conf && s->value && s->row_tents && s->row_free);
+    assert(s->col_tents && s->col_free && s->tree_tents && s->tree_free && s->trail && s->decisions && s->stamp);
+    assert(s->line_pack && s->level && s->reason && s->reasons_at && s->reasons && s->clauses && s->watches);
+    assert(s->learnt && s->seen_list && s->seen && s->tree_pack && s->comp_cells && s->scope && s->line_seen);
+    assert(s->cache && s->cache_keys && s->cache_key);
+
+    for (uint i = 0; i < s->nb_rows; i++)
+        s->row_need[i] = game_get_expected_nb_tents_row(g, i);
+    for (uint j = 0; j < s->nb_cols; j++)
+        s->col_need[j] = game_get_expected_nb_tents_col(g, j);
+    build_neighbourhoods(s, g);
+    build_patterns(&s->row_patterns, s->nb_cols, s->wrapping);
+    build_patterns(&s->col_patterns, s->nb_rows, s->wrapping);
+
+    s->nb_free = 0;
+    s->trail_size = 0;
+    s->qhead = 0;
+    s->depth = 0;
+    s->heuristic = solver_choose_mrv;
+    s->nb_decisions = 0;
+    s->nb_conflicts = s->nb_backtracks = 0;
+    s->stop = NULL;
+    s->cancel = NULL;
+    s->on_solution = NULL;
+    s->on_solution_data = NULL;
+    s->modulus = 0;
+    s->overflow = false;
+    s->deadline = 0;
+    s->max_decisions = 0;
+    s->max_memory = 0;
+    s->out_of_time = s->out_of_limits = false;
+    s->count_deadline = 0;
+    s->count_aborted = false;
+    s->progress = NULL;
+    s->progress_data = NULL;
+    s->progress_period = s->progress_start = s->next_report = 0;
+    s->nb_propagations = 0;
+    s->progress_done = s->progress_weight = 0;
+    s->comp_depth = 0;
+    s->use_patterns = false;
+    s->probing = false;
+    s->probe_budget = 0;
+    s->learning = false;
+    s->reasons_size = 0;
+    s->conflict = NO_REASON;
+    s->clauses_size = 0;
+    s->learnt_size = 0;
+    s->learnt_level = 0;
+    s->nb_seen = 0;
+    s->components = false;
+    s->comp_size = 0;
+    s->scope_id = 0;
+    s->caching = false;
+    s->keep_cache = false;
+    s->cache_used = 0;
+    s->keys_size = 0;
+    s->stamp_gen = 0;
+
+    // Only the candidates are left to decide: every other square is grass (or a tree)
+    for (uint c = 0; c < s->nb_cells; c++) {
+        s->value[c] = SOLVER_GRASS;
+        if (check_square_tent(candidates, c / s->nb_cols, c % s->nb_cols) || check_square_tent(g, c / s->nb_cols, c % s->nb_cols)) {
+            s->value[c] = SOLVER_UNKNOWN;
+            s->row_free[c / s->nb_cols]++;
+            s->col_free[c % s->nb_cols]++;
+            s->nb_free++;
+            for (uint k = 0; k < s->cell_nb_tree[c]; k++)
+                s->tree_free[s->cell_tree[c * MAX_TREES + k]]++;
+        }
+    }
+
+    // Tents already placed are the first assignments of the trail
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (check_square_tent(g, c / s->nb_cols, c % s->nb_cols))
+            solver_assign(s, c, SOLVER_TENT);
+
+    return s;
+}
+
+void solver_set_options(solver s, const solver_options *opts) {
+    assert(s && opts);
+    s->use_patterns = opts->line_patterns;
+    s->probing = opts->probing;
+    s->probe_budget = opts->probe_budget;
+    s->learning = opts->learning;
+    s->components = opts->components;
+    s->caching = opts->caching;
+    s->modulus = opts->modulus;
+    s->deadline = opts->max_seconds > 0 ? solver_now() + opts->max_seconds : 0;
+    s->max_decisions = opts->max_nodes;
+    s->max_memory = opts->max_memory;
+    s->cancel = opts->cancel;
+    s->heuristic = opts->branching == SOLVER_BRANCHING_FIRST ? solver_choose_first : solver_choose_mrv;
+    s->progress = opts->progress;
+    s->progress_data = opts->progress_data;
+    s->progress_period = opts->progress_period;
+    s->progress_start = solver_now();
+    s->next_report = s->progress_start + s->progress_period;
+}
+
+double solver_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+size_t solver_memory(solver s) {
+    size_t bytes = (size_t)(s->clauses_capacity + s->reasons_capacity + s->comp_capacity + s->keys_capacity) *
+                   sizeof(uint) + (size_t)s->cache_capacity * sizeof(cache_entry);
+    for (uint l = 0; l < 2 * s->nb_cells; l++)
+        bytes += (size_t)s->watches[l].capacity * sizeof(uint);
+    return bytes;
+}
+
+void solver_delete(solver s) {
+    assert(s);
+    free(s->row_need);
+    free(s->col_need);
+    free(s->tree_cell);
+    free(s->tree_cand);
+    free(s->tree_nb_cand);
+    free(s->cell_tree);
+    free(s->cell_nb_tree);
+    free(s->cell_conf);
+    free(s->cell_nb_conf);
+    free(s->value);
+    free(s->row_tents);
+    free(s->row_free);
+    free(s->col_tents);
+    free(s->col_free);
+    free(s->tree_tents);
+    free(s->tree_free);
+    free(s->trail);
+    free(s->decisions);
+    free(s->stamp);
+    free(s->line_pack);
+    free(s->level);
+    free(s->reason);
+    free(s->reasons_at);
+    free(s->reasons);
+    free(s->clauses);
+    for (uint l = 0; l < 2 * s->nb_cells; l++)
+        free(s->watches[l].clauses);
+    free(s->watches);
+    free(s->learnt);
+    free(s->seen_list);
+    free(s->seen);
+    free(s->tree_pack);
+    free(s->comp_cells);
+    free(s->scope);
+    free(s->line_seen);
+    free(s->cache);
+    free(s->cache_keys);
+    free(s->cache_key);
+    free(s->row_patterns.masks);
+    free(s->row_patterns.first);
+    free(s->col_patterns.masks);
+    free(s->col_patterns.first);
+    free(s);
+}
+
+/* ************************************************************************** */
+/*                             ASSIGN / UNDO                                  */
+/* ************************************************************************** */
+
+bool solver_assign(solver s, uint cell, cell_value v) {
+    assert(v == SOLVER_TENT || v == SOLVER_GRASS);
+    if (s->value[cell] != SOLVER_UNKNOWN)
+        return s->value[cell] == v;
+
+    uint i = cell / s->nb_cols, j = cell % s->nb_cols;
+    s->value[cell] = v;
+    s->level[cell] = s->depth;
+    s->reason[cell] = NO_REASON;
+    s->reasons_at[s->trail_size] = s->reasons_size;
+    s->trail[s->trail_size++] = cell;
+    s->nb_free--;
+    s->row_free[i]--;
+    s->col_free[j]--;
+    if (v == SOLVER_TENT) {
+        s->row_tents[i]++;
+        s->col_tents[j]++;
+    }
+    for (uint k = 0; k < s->cell_nb_tree[cell]; k++) {
+        uint t = s->cell_tree[cell * MAX_TREES + k];
+        s->tree_free[t]--;
+        if (v == SOLVER_TENT)
+            s->tree_tents[t]++;
+    }
+    return true;
+}
+
+// Gives back its unknown value to the last square of the trail
+static void unassign_last(solver s) {
+    uint cell = s->trail[--s->trail_size];
+    uint i = cell / s->nb_cols, j = cell % s->nb_cols;
+    cell_value v = s->value[cell];
+
+    s->value[cell] = SOLVER_UNKNOWN;
+    s->nb_free++;
+    s->row_free[i]++;
+    s->col_free[j]++;
+    if (v == SOLVER_TENT) {
+        s->row_tents[i]--;
+        s->col_tents[j]--;
+    }
+    for (uint k = 0; k < s->cell_nb_tree[cell]; k++) {
+        uint t = s->cell_tree[cell * MAX_TREES + k];
+        s->tree_free[t]++;
+        if (v == SOLVER_TENT)
+            s->tree_tents[t]--;
+    }
+}
+
+void solver_undo(solver s, uint mark) {
+    if (s->trail_size > mark)
+        s->reasons_size = s->reasons_at[mark];
+    while (s->trail_size > mark)
+        unassign_last(s);
+    if (s->qhead > mark)
+        s->qhead = mark;
+}
+
+/* ************************************************************************** */
+/*                                 REASONS                                    */
+/* ************************************************************************** */
+
+/* When learning is enabled, every assignment made by the propagation keeps a reason: the facts (square values) that
+ * made it necessary. Facts of decision level 0 hold for the whole search and are left out. A contradiction keeps the
+ * facts that can't hold together in the same way. Records live on a stack that is cut back by solver_undo.
+ */
+
+static uint make_lit(uint cell, cell_value v) { return 2 * cell + (v == SOLVER_GRASS); }
+static uint lit_cell(uint lit) { return lit >> 1; }
+static cell_value lit_value(uint lit) { return (lit & 1) ? SOLVER_GRASS : SOLVER_TENT; }
+
+// Pushes a value on the records, which grow as needed
+static void reason_push(solver s, uint x) {
+    if (s->reasons_size == s->reasons_capacity) {
+        s->reasons_capacity *= 2;
+        s->reasons = realloc(s->reasons, s->reasons_capacity * sizeof(uint));
+        assert(s->reasons);
+    }
+    s->reasons[s->reasons_size++] = x;
+}
+
+// Starts a new empty record, or returns NO_REASON if learning is disabled
+static uint reason_begin(solver s) {
+    if (!s->learning)
+        return NO_REASON;
+    reason_push(s, 0);
+    return s->reasons_size - 1;
+}
+
+// Drops the record begun last (rec) if no assignment refers to it
+static void reason_drop(solver s, uint rec, bool used) {
+    if (rec != NO_REASON && !used)
+        s->reasons_size = rec;
+}
+
+// Adds the current value of cell to the record begun last (rec)
+static void reason_add(solver s, uint rec, uint cell) {
+    if (rec == NO_REASON || s->level[cell] == 0)
+        return;
+    reason_push(s, make_lit(cell, s->value[cell]));
+    s->reasons[rec]++;
+}
+
+// Adds every square of value v of a line to the record begun last (rec)
+static void reason_add_line(solver s, uint rec, uint first, uint step, uint len, cell_value v) {
+    if (rec == NO_REASON)
+        return;
+    for (uint k = 0; k < len; k++)
+        if (s->value[first + k * step] == v)
+            reason_add(s, rec, first + k * step);
+}
+
+// Adds the grass squares around tree t to the record begun last (rec)
+static void reason_add_tree(solver s, uint rec, uint t) {
+    if (rec == NO_REASON)
+        return;
+    for (uint k = 0; k < s->tree_nb_cand[t]; k++)
+        if (s->value[s->tree_cand[t * MAX_TREES + k]] == SOLVER_GRASS)
+            reason_add(s, rec, s->tree_cand[t * MAX_TREES + k]);
+}
+
+// Records a contradiction, whose facts are in rec. Always returns false.
+static bool contradiction(solver s, uint rec) {
+    s->conflict = rec;
+    return false;
+}
+
+// Assigns v to cell because of the facts of rec. Returns false (and records the contradiction) if cell holds the
+// other value.
+static bool imply(solver s, uint cell, cell_value v, uint rec) {
+    if (s->value[cell] == v)
+        return true;
+    if (s->value[cell] != SOLVER_UNKNOWN) {
+        uint conflict = reason_begin(s);
+        for (uint k = 0; rec != NO_REASON && k < s->reasons[rec]; k++) {
+            reason_push(s, s->reasons[rec + 1 + k]);
+            s->reasons[conflict]++;
+        }
+        reason_add(s, conflict, cell);
+        return contradiction(s, conflict);
+    }
+    solver_assign(s, cell, v);
+    s->reason[cell] = rec;
+    return true;
+}
+
+/* ************************************************************************** */
+/*                               PROPAGATION                                  */
+/* ************************************************************************** */
+
+// Fills the unknown squares of row i (step 1) or column j (step nb_cols) with v: the reason is the squares of the
+// line holding the other value
+static bool fill_line(solver s, uint first, uint step, uint len, cell_value v) {
+    uint rec = reason_begin(s);
+    reason_add_line(s, rec, first, step, len, v == SOLVER_TENT ? SOLVER_GRASS : SOLVER_TENT);
+    for (uint k = 0; k < len; k++)
+        if (s->value[first + k * step] == SOLVER_UNKNOWN)
+            if (!imply(s, first + k * step, v, rec))
+                return false;
+    return true;
+}
+
+/* The tents of a line follow one of the patterns of its width (see pattern_table) that has as many tents as the line
+ * expects, a tent on every tent of the line and none on its grass. The unknown squares on which all these patterns
+ * agree get their value, because of the squares already decided in the line.
+ */
+static bool check_patterns(solver s, uint need, uint first, uint step, uint len) {
+    const pattern_table *t = len == s->row_patterns.width ? &s->row_patterns : &s->col_patterns;
+    if (t->masks == NULL || need > len)
+        return true;
+    uint tents = 0, allowed = 0;
+    for (uint k = 0; k < len; k++) {
+        tents |= (uint)(s->value[first + k * step] == SOLVER_TENT) << k;
+        allowed |= (uint)(s->value[first + k * step] != SOLVER_GRASS) << k;
+    }
+
+    bool found = false;
+    uint can = 0, must = UINT32_MAX;  // Squares holding a tent in some / every pattern left
+    for (uint p = t->first[need]; p < t->first[need + 1]; p++) {
+        uint m = t->masks[p];
+        if ((m & ~allowed) == 0 && (m & tents) == tents) {
+            found = true;
+            can |= m;
+            must &= m;
+        }
+    }
+    uint unknown = allowed & ~tents;
+    if (found && (unknown & ~can) == 0 && (unknown & must) == 0)
+        return true;
+
+    uint rec = reason_begin(s);
+    reason_add_line(s, rec, first, step, len, SOLVER_TENT);
+    reason_add_line(s, rec, first, step, len, SOLVER_GRASS);
+    if (!found)
+        return contradiction(s, rec);
+    for (uint k = 0; k < len; k++) {
+        if (!(unknown >> k & 1) || ((can >> k & 1) && !(must >> k & 1)))
+            continue;
+        if (!imply(s, first + k * step, (must >> k & 1) ? SOLVER_TENT : SOLVER_GRASS, rec))
+            return false;
+    }
+    return true;
+}
+
+// Checks the expected number of tents of a line: full lines get grass, lines with just enough room get tents (and the
+// other squares are checked against the patterns of the line when enabled)
+static bool check_line(solver s, uint tents, uint free, uint need, uint first, uint step, uint len) {
+    if (tents > need || tents + free < need) {
+        uint rec = reason_begin(s);
+        reason_add_line(s, rec, first, step, len, tents > need ? SOLVER_TENT : SOLVER_GRASS);
+        return contradiction(s, rec);
+    }
+    if (free == 0)
+        return true;
+    if (tents == need)
+        return fill_line(s, first, step, len, SOLVER_GRASS);
+    if (tents + free == need)
+        return fill_line(s, first, step, len, SOLVER_TENT);
+    return !s->use_patterns || check_patterns(s, need, first, step, len);
+}
+
+static bool check_row(solver s, uint i) {
+    return check_line(s, s->row_tents[i], s->row_free[i], s->row_need[i], i * s->nb_cols, 1, s->nb_cols);
+}
+
+static bool check_col(solver s, uint j) {
+    return check_line(s, s->col_tents[j], s->col_free[j], s->col_need[j], j, s->nb_cols, s->nb_rows);
+}
+
+// A tree without tent needs at least one square left around it, and gets a tent if there is only one
+static bool check_tree(solver s, uint t) {
+    if (s->tree_tents[t] > 0 || s->tree_free[t] > 1)
+        return true;
+    uint rec = reason_begin(s);
+    reason_add_tree(s, rec, t);
+    if (s->tree_free[t] == 0)
+        return contradiction(s, rec);
+    for (uint k = 0; k < s->tree_nb_cand[t]; k++) {
+        uint c = s->tree_cand[t * MAX_TREES + k];
+        if (s->value[c] == SOLVER_UNKNOWN)
+            return imply(s, c, SOLVER_TENT, rec);
+    }
+    return true;
+}
+
+// Adds clause cl (its position in the clauses) to the watch list of lit
+static void watch(solver s, uint lit, uint cl) {
+    watch_list *w = &s->watches[lit];
+    if (w->size == w->capacity) {
+        w->capacity = 2 * w->capacity + 4;
+        w->clauses = realloc(w->clauses, w->capacity * sizeof(uint));
+        assert(w->clauses);
+    }
+    w->clauses[w->size++] = cl;
+}
+
+// Visits the learned clauses watching lit, which has just become false: each one either finds another literal to
+// watch, or propagates its last literal, or is a contradiction
+static bool propagate_clauses(solver s, uint lit) {
+    watch_list *w = &s->watches[lit];
+    uint i = 0, j = 0;
+    bool ok = true;
+
+    while (i < w->size) {
+        uint cl = w->clauses[i++];
+        uint size = s->clauses[cl];
+        uint *lits = &s->clauses[cl + 1];
+        w->clauses[j++] = cl;
+        if (!ok)
+            continue;
+
+        if (size > 1 && lits[0] == lit) {  // The false literal goes second
+            lits[0] = lits[1];
+            lits[1] = lit;
+        }
+        if (s->value[lit_cell(lits[0])] == lit_value(lits[0]))  // Clause already satisfied
+            continue;
+
+        bool moved = false;
+        for (uint k = 2; k < size && !moved; k++)
+            if (s->value[lit_cell(lits[k])] == SOLVER_UNKNOWN || s->value[lit_cell(lits[k])] == lit_value(lits[k])) {
+                lits[1] = lits[k];
+                lits[k] = lit;
+                watch(s, lits[1], cl);
+                j--;
+                moved = true;
+            }
+        if (moved)
+            continue;
+
+        uint rec = reason_begin(s);
+        for (uint k = 1; k < size; k++)
+            reason_add(s, rec, lit_cell(lits[k]));
+        ok = imply(s, lit_cell(lits[0]), lit_value(lits[0]), rec);
+    }
+    w->size = j;
+    return ok;
+}
+
+// Propagates the consequences of the assignment of a square
+static bool propagate_cell(solver s, uint cell) {
+    if (s->value[cell] == SOLVER_TENT) {
+        uint rec = reason_begin(s);
+        reason_add(s, rec, cell);
+        bool used = false;
+        for (uint k = 0; k < s->cell_nb_conf[cell]; k++) {
+            uint c = s->cell_conf[cell * MAX_CONF + k];
+            used |= s->value[c] == SOLVER_UNKNOWN;
+            if (!imply(s, c, SOLVER_GRASS, rec))
+                return false;
+        }
+        reason_drop(s, rec, used);
+    }
+
+    if (!check_row(s, cell / s->nb_cols) || !check_col(s, cell % s->nb_cols))
+        return false;
+
+    if (s->value[cell] == SOLVER_GRASS)
+        for (uint k = 0; k < s->cell_nb_tree[cell]; k++)
+            if (!check_tree(s, s->cell_tree[cell * MAX_TREES + k]))
+                return false;
+
+    return propagate_clauses(s, make_lit(cell, s->value[cell] == SOLVER_TENT ? SOLVER_GRASS : SOLVER_TENT));
+}
+
+/* ************************************************************************** */
+/*                             TREE COVER CHECK                               */
+/* ************************************************************************** */
+
+/* Rule 4 only asks every tree to touch a tent (a tent may be shared by several trees), so the trees don't need
+ * a perfect matching with the tents and a Hall condition on the trees would cut real solutions. What still holds
+ * is that trees whose remaining squares are pairwise disjoint need as many distinct tents. The check below packs
+ * such trees greedily, globally and line by line (trees whose remaining squares all lie on one row or one column).
+ * When a component is being counted, the global packing only looks at its trees and lines, so that the numbers of
+ * solutions of the components don't depend on each other (see the component decomposition):
+ *      -> If a packing is larger than the number of tents left to place (in the game or in the line), there is no
+ *         solution below this node.
+ *      -> If a line packing uses exactly the tents left in the line, the tents of the line all go to the packed
+ *         trees, so every other unknown square of the line is grass.
+ */
+
+// Starts a new generation of stamps: a square is marked when its stamp equals stamp_gen
+static void new_stamp(solver s) {
+    if (++s->stamp_gen == 0) {
+        memset(s->stamp, 0, s->nb_cells * sizeof(uint));
+        s->stamp_gen = 1;
+    }
+}
+
+// Whether cell belongs to the component being searched (see the component decomposition)
+static bool in_scope(solver s, uint cell) {
+    return s->scope_id == 0 || s->scope[cell] == s->scope_id;
+}
+
+// Whether the unknown squares of the line belong to the component being searched
+static bool line_in_scope(solver s, uint first, uint step, uint len) {
+    for (uint k = 0; s->scope_id != 0 && k < len; k++)
+        if (s->value[first + k * step] == SOLVER_UNKNOWN)
+            return in_scope(s, first + k * step);
+    return true;
+}
+
+// Whether the unknown squares around tree t belong to the component being searched
+static bool tree_in_scope(solver s, uint t) {
+    for (uint k = 0; s->scope_id != 0 && k < s->tree_nb_cand[t]; k++)
+        if (s->value[s->tree_cand[t * MAX_TREES + k]] == SOLVER_UNKNOWN)
+            return in_scope(s, s->tree_cand[t * MAX_TREES + k]);
+    return true;
+}
+
+// Packs tree t if none of its unknown squares is marked yet. Returns true if the tree was packed.
+static bool pack_tree(solver s, uint t) {
+    for (uint k = 0; k < s->tree_nb_cand[t]; k++) {
+        uint c = s->tree_cand[t * MAX_TREES + k];
+        if (s->value[c] == SOLVER_UNKNOWN && s->stamp[c] == s->stamp_gen)
+            return false;
+    }
+    for (uint k = 0; k < s->tree_nb_cand[t]; k++) {
+        uint c = s->tree_cand[t * MAX_TREES + k];
+        if (s->value[c] == SOLVER_UNKNOWN)
+            s->stamp[c] = s->stamp_gen;
+    }
+    return true;
+}
+
+// Returns the line (row if by_row, column otherwise) holding all the unknown squares of tree t, or -1
+static int tree_line(solver s, uint t, bool by_row) {
+    int line = -1;
+    for (uint k = 0; k < s->tree_nb_cand[t]; k++) {
+        uint c = s->tree_cand[t * MAX_TREES + k];
+        if (s->value[c] != SOLVER_UNKNOWN)
+            continue;
+        int l = by_row ? (int)(c / s->nb_cols) : (int)(c % s->nb_cols);
+        if (line != -1 && line != l)
+            return -1;
+        line = l;
+    }
+    return line;
+}
+
+// Adds the reason of a packing to the record begun last (rec): the grass squares around the trees packed with the
+// given mark in tree_pack
+static void reason_add_pack(solver s, uint rec, uint mark) {
+    if (rec == NO_REASON)
+        return;
+    for (uint t = 0; t < s->nb_trees; t++)
+        if (s->tree_pack[t] == mark)
+            reason_add_tree(s, rec, t);
+}
+
+// Begins the reason of a line packing: the tents of the line and the grass squares around the trees packed in it
+static uint line_pack_reason(solver s, uint first, uint step, uint len, uint l) {
+    uint rec = reason_begin(s);
+    reason_add_line(s, rec, first, step, len, SOLVER_TENT);
+    reason_add_pack(s, rec, l + 1);
+    return rec;
+}
+
+// Line packing (see above) for all the rows or all the columns
+static bool cover_lines(solver s, bool by_row, uint *packed) {
+    uint nb_lines = by_row ? s->nb_rows : s->nb_cols;
+    memset(packed, 0, nb_lines * sizeof(uint));
+    new_stamp(s);
+
+    for (uint t = 0; t < s->nb_trees; t++) {
+        s->tree_pack[t] = 0;
+        if (s->tree_tents[t] > 0)
+            continue;
+        int l = tree_line(s, t, by_row);
+        if (l >= 0 && pack_tree(s, t)) {
+            packed[l]++;
+            s->tree_pack[t] = l + 1;
+        }
+    }
+
+    for (uint l = 0; l < nb_lines; l++) {
+        uint need = by_row ? s->row_need[l] - s->row_tents[l] : s->col_need[l] - s->col_tents[l];
+        if (packed[l] == 0 || packed[l] < need)
+            continue;
+        uint first = by_row ? l * s->nb_cols : l;
+        uint step = by_row ? 1 : s->nb_cols;
+        uint len = by_row ? s->nb_cols : s->nb_rows;
+        if (packed[l] > need)
+            return contradiction(s, line_pack_reason(s, first, step, len, l));
+        bool started = false;
+        uint rec = NO_REASON;
+        for (uint k = 0; k < len; k++) {
+            uint c = first + k * step;
+            if (s->value[c] != SOLVER_UNKNOWN || s->stamp[c] == s->stamp_gen)
+                continue;
+            if (!started)  // The reason is only built when it is needed
+                rec = line_pack_reason(s, first, step, len, l), started = true;
+            imply(s, c, SOLVER_GRASS, rec);
+        }
+    }
+    return true;
+}
+
+// Runs the tree cover check. Returns false on a contradiction (new assignments are left to the propagation).
+static bool cover_check(solver s) {
+    uint tents_left = 0, packed = 0;
+    for (uint i = 0; i < s->nb_rows; i++)
+        if (s->row_free[i] > 0 && line_in_scope(s, i * s->nb_cols, 1, s->nb_cols))
+            tents_left += s->row_need[i] - s->row_tents[i];
+
+    new_stamp(s);
+    for (uint t = 0; t < s->nb_trees; t++) {
+        s->tree_pack[t] = s->tree_tents[t] == 0 && tree_in_scope(s, t) && pack_tree(s, t);
+        packed += s->tree_pack[t];
+    }
+    if (packed > tents_left) {
+        uint rec = reason_begin(s);
+        for (uint c = 0; rec != NO_REASON && c < s->nb_cells; c++)
+            if (s->value[c] == SOLVER_TENT)
+                reason_add(s, rec, c);
+        reason_add_pack(s, rec, 1);
+        return contradiction(s, rec);
+    }
+
+    return cover_lines(s, true, s->line_pack) && cover_lines(s, false, s->line_pack);
+}
+
+// Propagates until a fixpoint, or until budget squares have been propagated (0 for no limit) which is not a contradiction
+static bool propagate_budget(solver s, uint budget) {
+    uint start = s->qhead;
+    while (true) {
+        while (s->qhead < s->trail_size) {
+            if (budget != 0 && s->qhead - start >= budget)
+                return true;
+            s->nb_propagations++;
+            if (!propagate_cell(s, s->trail[s->qhead++])) {
+                s->nb_conflicts++;
+                return false;
+            }
+        }
+        if (!cover_check(s)) {
+            s->nb_conflicts++;
+            return false;
+        }
+        if (s->qhead == s->trail_size)  // No new assignment: fixpoint reached
+            return true;
+    }
+}
+
+bool solver_propagate(solver s) {
+    return propagate_budget(s, 0);
+}
+
+/* ************************************************************************** */
+/*                                 LEARNING                                   */
+/* ************************************************************************** */
+
+/* A contradiction is explained by going back along the trail: every fact of the decision level of the contradiction
+ * is replaced by its reason, until a single fact of that level is left (the first unique implication point). The facts
+ * left can't all hold, which gives the nogood "one of them is false", kept as a clause whose two watched literals are
+ * updated by the propagation. As the facts of the level before it still hold, the nogood forces the square of the
+ * unique implication point to its other value as soon as the search is back to the level of its other facts.
+ */
+
+// Highest decision level of the facts of record rec
+static uint record_level(solver s, uint rec) {
+    uint lvl = 0;
+    for (uint k = 0; k < s->reasons[rec]; k++) {
+        uint l = s->level[lit_cell(s->reasons[rec + 1 + k])];
+        if (l > lvl)
+            lvl = l;
+    }
+    return lvl;
+}
+
+// Marks a fact met by the analysis: the facts of level lvl are counted in pending, the others go to the nogood
+static void analyze_fact(solver s, uint fact, uint lvl, uint *pending) {
+    uint cell = lit_cell(fact);
+    if (s->seen[cell] || s->level[cell] == 0)
+        return;
+    s->seen[cell] = true;
+    s->seen_list[s->nb_seen++] = cell;
+    if (s->level[cell] == lvl)
+        (*pending)++;
+    else
+        s->learnt[s->learnt_size++] = fact;
+}
+
+/* Explains the contradiction of record rec at decision level lvl. The facts of the nogood go to learnt, the one of level
+ * lvl first (NO_REASON if the other facts are already contradictory) and learnt_level is the highest level of the
+ * others. If to_probe, the facts of level lvl are explained up to the assignment without reason that opened the level.
+ */
+static void analyze(solver s, uint rec, uint lvl, bool to_probe) {
+    uint pending = 0;
+    s->learnt[0] = NO_REASON;
+    s->learnt_size = 1;
+    s->nb_seen = 0;
+    for (uint k = 0; k < s->reasons[rec]; k++)
+        analyze_fact(s, s->reasons[rec + 1 + k], lvl, &pending);
+
+    for (uint i = s->trail_size; pending > 0;) {
+        uint cell = s->trail[--i];
+        if (!s->seen[cell])
+            continue;
+        pending--;
+        uint r = s->reason[cell];
+        if (pending == 0 && (!to_probe || r == NO_REASON)) {
+            s->learnt[0] = make_lit(cell, s->value[cell]);
+            break;
+        }
+        assert(r != NO_REASON);  // Only the first assignment of a level has no reason
+        for (uint k = 0; k < s->reasons[r]; k++)
+            analyze_fact(s, s->reasons[r + 1 + k], lvl, &pending);
+    }
+
+    s->learnt_level = 0;
+    for (uint k = 1; k < s->learnt_size; k++)
+        if (s->level[lit_cell(s->learnt[k])] > s->learnt_level)
+            s->learnt_level = s->level[lit_cell(s->learnt[k])];
+    for (uint k = 0; k < s->nb_seen; k++)
+        s->seen[s->seen_list[k]] = false;
+}
+
+// Watch priority of the literal denying fact: literals that are not false first, then false ones of higher level
+static uint watch_priority(solver s, uint fact) {
+    uint cell = lit_cell(fact);
+    if (s->value[cell] != lit_value(fact))
+        return UINT32_MAX;
+    return s->level[cell];
+}
+
+// Forgets all the learned clauses
+static void clear_clauses(solver s) {
+    s->clauses_size = 0;
+    for (uint l = 0; l < 2 * s->nb_cells; l++)
+        s->watches[l].size = 0;
+}
+
+/* Adds the nogood of the last analysis to the learned clauses (unless it has more than max_size facts or the clauses
+ * are already too large) and propagates it in the current state. Returns false on a contradiction.
+ */
+static bool learn(solver s, uint max_size) {
+    uint size = s->learnt_size;
+    for (uint w = 0; w < 2 && w < size; w++)
+        for (uint k = w + 1; k < size; k++)
+            if (watch_priority(s, s->learnt[k]) > watch_priority(s, s->learnt[w])) {
+                uint tmp = s->learnt[k];
+                s->learnt[k] = s->learnt[w];
+                s->learnt[w] = tmp;
+            }
+
+    if (size <= max_size && s->clauses_size + size + 1 <= MAX_CLAUSES_SIZE) {
+        if (s->clauses_size + size + 1 > s->clauses_capacity) {
+            s->clauses_capacity = 2 * s->clauses_capacity + size + 1;
+            s->clauses = realloc(s->clauses, s->clauses_capacity * sizeof(uint));
+            assert(s->clauses);
+        }
+        uint cl = s->clauses_size;
+        s->clauses[s->clauses_size++] = size;
+        for (uint k = 0; k < size; k++)
+            s->clauses[s->clauses_size++] = s->learnt[k] ^ 1;
+        watch(s, s->learnt[0] ^ 1, cl);
+        if (size > 1)
+            watch(s, s->learnt[1] ^ 1, cl);
+    }
+
+    if (watch_priority(s, s->learnt[0]) == UINT32_MAX && s->value[lit_cell(s->learnt[0])] != SOLVER_UNKNOWN)
+        return true;  // Already satisfied
+    if (size > 1 && watch_priority(s, s->learnt[1]) == UINT32_MAX)
+        return true;  // At least two literals are not false yet
+
+    uint rec = reason_begin(s);
+    for (uint k = 1; k < size; k++)
+        reason_add(s, rec, lit_cell(s->learnt[k]));
+    uint cell = lit_cell(s->learnt[0]);
+    return imply(s, cell, lit_value(s->learnt[0]) == SOLVER_TENT ? SOLVER_GRASS : SOLVER_TENT, rec);
+}
+
+/* ************************************************************************** */
+/*                                 PROBING                                    */
+/* ************************************************************************** */
+
+// Tries v on the unknown square cell and undoes it. Returns false if v leads to a contradiction, whose explanation is
+// then in learnt when learning is enabled (the probe gets a decision level of its own).
+static bool probe_value(solver s, uint cell, cell_value v) {
+    uint mark = s->trail_size;
+    s->depth++;
+    solver_assign(s, cell, v);
+    bool ok = propagate_budget(s, s->probe_budget);
+    if (!ok && s->learning)
+        analyze(s, s->conflict, s->depth, true);
+    s->depth--;
+    solver_undo(s, mark);
+    return ok;
+}
+
+// Gives the square the value left by a failed probe, with the other facts of the explanation as reason
+static bool probe_force(solver s, uint cell, cell_value v) {
+    uint rec = reason_begin(s);
+    for (uint k = 1; rec != NO_REASON && k < s->learnt_size; k++)
+        reason_add(s, rec, lit_cell(s->learnt[k]));
+    if (rec != NO_REASON && s->learnt[0] == NO_REASON)  // The contradiction didn't depend on the probe
+        return contradiction(s, rec);
+    return imply(s, cell, v, rec);
+}
+
+/* Every unknown square (of the component being counted, if any) is given both values in turn. When one of them leads
+ * to a contradiction, the square gets the other one for good (until the search backtracks above this node) and the pass
+ * starts again, until no probe fails.
+ */
+bool solver_probe(solver s) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint c = 0; c < s->nb_cells; c++) {
+            if (s->value[c] != SOLVER_UNKNOWN || !in_scope(s, c))
+                continue;
+            cell_value forced = SOLVER_UNKNOWN;
+            if (!probe_value(s, c, SOLVER_TENT))
+                forced = SOLVER_GRASS;
+            else if (!probe_value(s, c, SOLVER_GRASS))
+                forced = SOLVER_TENT;
+            if (forced == SOLVER_UNKNOWN)
+                continue;
+            if (!probe_force(s, c, forced) || !solver_propagate(s))
+                return false;
+            changed = true;
+        }
+    }
+    return true;
+}
+
+// Checks all the lines and trees once, before the first assignment is propagated
+static bool initial_propagate(solver s) {
+    uint sum_rows = 0, sum_cols = 0;
+    for (uint i = 0; i < s->nb_rows; i++)
+        sum_rows += s->row_need[i];
+    for (uint j = 0; j < s->nb_cols; j++)
+        sum_cols += s->col_need[j];
+    if (sum_rows != s->nb_trees || sum_cols != s->nb_trees)  // Rules 2 and 3 can't hold together
+        return false;
+
+    for (uint i = 0; i < s->nb_rows; i++)
+        if (!check_row(s, i))
+            return false;
+    for (uint j = 0; j < s->nb_cols; j++)
+        if (!check_col(s, j))
+            return false;
+    for (uint t = 0; t < s->nb_trees; t++)
+        if (!check_tree(s, t))
+            return false;
+    return solver_propagate(s);
+}
+
+bool solver_prepare(solver s) {
+    s->depth = 0;
+    s->conflict = NO_REASON;
+    clear_clauses(s);
+    return initial_propagate(s);
+}
+
+bool solver_prepare_learnt(solver s) {
+    s->depth = 0;
+    s->conflict = NO_REASON;
+    bool ok = initial_propagate(s);
+    // The other nogoods are propagated as their literals become false, but a nogood of a single fact only when learned
+    for (uint cl = 0; ok && cl < s->clauses_size; cl += s->clauses[cl] + 1)
+        if (s->clauses[cl] == 1) {
+            uint lit = s->clauses[cl + 1];
+            ok = imply(s, lit_cell(lit), lit_value(lit), reason_begin(s)) && solver_propagate(s);
+        }
+    if (ok && s->probing)
+        ok = solver_probe(s);
+    return ok;
+}
+
+/* ************************************************************************** */
+/*                                COMPONENTS                                  */
+/* ************************************************************************** */
+
+/* Two unknown squares depend on each other when they are on the same row or column, around the same tree without tent,
+ * or in conflict. The components of this dependency graph are independent puzzles: when counting, the number of
+ * solutions below a node is the product of the numbers of solutions of the components. Each component is searched on
+ * its own (the decisions are taken inside it), and split again as soon as its propagation breaks it apart.
+ * Every deduction of the propagation holds for all the solutions, so deductions made outside the component being
+ * searched don't change its number of solutions as long as the board has one.
+ */
+
+// Pushes a value on the component lists, which grow as needed
+static void comp_push(solver s, uint x) {
+    if (s->comp_size == s->comp_capacity) {
+        s->comp_capacity *= 2;
+        s->comp_cells = realloc(s->comp_cells, s->comp_capacity * sizeof(uint));
+        assert(s->comp_cells);
+    }
+    s->comp_cells[s->comp_size++] = x;
+}
+
+// Adds cell to the component being built if it is unknown and not in a component yet
+static void comp_visit(solver s, uint cell) {
+    if (s->value[cell] == SOLVER_UNKNOWN && s->stamp[cell] != s->stamp_gen) {
+        s->stamp[cell] = s->stamp_gen;
+        comp_push(s, cell);
+    }
+}
+
+// Adds the unknown squares of a line (line is its index among the rows then the columns) to the component being built
+static void comp_visit_line(solver s, uint line, uint first, uint step, uint len) {
+    if (s->line_seen[line] == s->stamp_gen)
+        return;
+    s->line_seen[line] = s->stamp_gen;
+    for (uint k = 0; k < len; k++)
+        comp_visit(s, first + k * step);
+}
+
+/* Splits the unknown squares among the nb squares of the component lists starting at first into components, pushed
+ * after the lists (each one preceded by its size). Returns the number of components.
+ */
+static uint split_components(solver s, uint first, uint nb) {
+    uint nb_comp = 0;
+    new_stamp(s);
+    for (uint k = 0; k < nb; k++) {
+        uint start = s->comp_cells[first + k];
+        if (s->value[start] != SOLVER_UNKNOWN || s->stamp[start] == s->stamp_gen)
+            continue;
+        uint head = s->comp_size;
+        comp_push(s, 0);
+        comp_visit(s, start);
+        for (uint q = head + 1; q < s->comp_size; q++) {  // Breadth-first search, the list being the queue
+            uint c = s->comp_cells[q], i = c / s->nb_cols, j = c % s->nb_cols;
+            comp_visit_line(s, i, i * s->nb_cols, 1, s->nb_cols);
+            comp_visit_line(s, s->nb_rows + j, j, s->nb_cols, s->nb_rows);
+            for (uint m = 0; m < s->cell_nb_conf[c]; m++)
+                comp_visit(s, s->cell_conf[c * MAX_CONF + m]);
+            for (uint m = 0; m < s->cell_nb_tree[c]; m++) {
+                uint t = s->cell_tree[c * MAX_TREES + m];
+                for (uint n = 0; s->tree_tents[t] == 0 && n < s->tree_nb_cand[t]; n++)
+                    comp_visit(s, s->tree_cand[t * MAX_TREES + n]);
+            }
+        }
+        s->comp_cells[head] = s->comp_size - head - 1;
+        nb_comp++;
+    }
+    return nb_comp;
+}
+
+/* The number of solutions of a component only depends on its squares, on the trees without tent around them and on
+ * the tents still expected by their lines: the squares decided outside of it are grass next to it (a tent would have
+ * made them grass) and the propagation is kept inside it. Those make the key of the component in the cache, so that
+ * a component reached again by another path of the search gets its number of solutions without being searched.
+ * The keys are stored in full, so that two components with the same hash are told apart.
+ */
+
+// Maximum number of values kept in the keys of the cache (four per square), beyond which nothing more is cached
+#define MAX_CACHE_KEYS (1u << 24)
+
+static int compare_uint(const void *a, const void *b) {
+    uint x = *(const uint *)a, y = *(const uint *)b;
+    return (x > y) - (x < y);
+}
+
+// Builds the key of a component in cache_key (sorting its squares) and returns its size: for each square, the square,
+// the trees without tent around it (one bit each) and the tents still expected by its row and by its column
+static uint cache_make_key(solver s, uint first, uint nb) {
+    qsort(s->comp_cells + first, nb, sizeof(uint), compare_uint);
+    uint size = 0;
+    for (uint k = 0; k < nb; k++) {
+        uint c = s->comp_cells[first + k], i = c / s->nb_cols, j = c % s->nb_cols, trees = 0;
+        for (uint m = 0; m < s->cell_nb_tree[c]; m++)
+            trees |= (uint)(s->tree_tents[s->cell_tree[c * MAX_TREES + m]] == 0) << m;
+        s->cache_key[size++] = c;
+        s->cache_key[size++] = trees;
+        s->cache_key[size++] = s->row_need[i] - s->row_tents[i];
+        s->cache_key[size++] = s->col_need[j] - s->col_tents[j];
+    }
+    return size;
+}
+
+static uint64_t cache_hash(const uint *key, uint size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (uint k = 0; k < size; k++)
+        h = (h ^ key[k]) * 1099511628211ULL;
+    return h ^ (h >> 29);
+}
+
+// Returns the entry of a key in the table, or the free entry where it would go
+static cache_entry *cache_find(solver s, const uint *key, uint size, uint64_t hash) {
+    uint mask = s->cache_capacity - 1;
+    for (uint e = hash & mask;; e = (e + 1) & mask) {
+        cache_entry *entry = &s->cache[e];
+        if (entry->size == 0)
+            return entry;
+        if (entry->hash == hash && entry->size == size &&
+            memcmp(s->cache_keys + entry->key, key, size * sizeof(uint)) == 0)
+            return entry;
+    }
+}
+
+// Copies the key built last into the stored keys and returns its position, or UINT32_MAX if the cache is full
+static uint cache_keep_key(solver s, uint size) {
+    if (s->keys_size + size > MAX_CACHE_KEYS)
+        return UINT32_MAX;
+    while (s->keys_size + size > s->keys_capacity) {
+        s->keys_capacity *= 2;
+        s->cache_keys = realloc(s->cache_keys, s->keys_capacity * sizeof(uint));
+        assert(s->cache_keys);
+    }
+    memcpy(s->cache_keys + s->keys_size, s->cache_key, size * sizeof(uint));
+    s->keys_size += size;
+    return s->keys_size - size;
+}
+
+// Adds the number of solutions of the stored key at position key to the table, which is kept at most half full
+static void cache_insert(solver s, uint key, uint size, uint64_t hash, uint64_t count) {
+    if (2 * (s->cache_used + 1) > s->cache_capacity) {
+        cache_entry *old = s->cache;
+        uint old_capacity = s->cache_capacity;
+        s->cache_capacity *= 2;
+        s->cache = calloc(s->cache_capacity, sizeof(cache_entry));
+        assert(s->cache);
+        for (uint e = 0; e < old_capacity; e++)
+            if (old[e].size != 0)
+                *cache_find(s, s->cache_keys + old[e].key, old[e].size, old[e].hash) = old[e];
+        free(old);
+    }
+    cache_entry *entry = cache_find(s, s->cache_keys + key, size, hash);
+    if (entry->size == 0)
+        s->cache_used++;
+    *entry = (cache_entry){hash, count, key, size};
+}
+
+void solver_clear_cache(solver s) {
+    assert(s);
+    s->cache_used = 0;
+    s->keys_size = 0;
+    memset(s->cache, 0, s->cache_capacity * sizeof(cache_entry));
+}
+
+uint64_t solver_count_add(solver s, uint64_t a, uint64_t b) {
+    if (s->modulus != 0)
+        return (a % s->modulus + b % s->modulus) % s->modulus;
+    if (a > UINT64_MAX - b) {
+        s->overflow = true;
+        return UINT64_MAX;
+    }
+    return a + b;
+}
+
+uint64_t solver_count_mul(solver s, uint64_t a, uint64_t b) {
+    if (s->modulus != 0)  // The modulus has 32 bits, so that the product of two residues has at most 64
+        return (a % s->modulus) * (b % s->modulus) % s->modulus;
+    if (a != 0 && b > UINT64_MAX / a) {
+        s->overflow = true;
+        return UINT64_MAX;
+    }
+    return a * b;
+}
+
+/* The share of the search tree closed by the component counting is the sum of the shares of the nodes done: the root
+ * has a share of 1, split in two between the branches of a decision and equally between the components of a node.
+ * The depth-first search gets it from its decisions instead (see search_fraction).
+ */
+
+// Share of the search tree closed by the depth-first search: the first branch of every decision in its second one
+static double search_fraction(solver s) {
+    double fraction = 0, share = 0.5;
+    for (uint k = 0; k < s->depth && share > 0; k++, share /= 2)
+        if (s->decisions[k].second)
+            fraction += share;
+    return fraction;
+}
+
+// Calls the progress callback when its period is over (the clock is only checked every 64 decisions)
+static void report(solver s) {
+    if (s->progress == NULL || s->nb_decisions % 64 != 0)
+        return;
+    double now = solver_now();
+    if (now < s->next_report)
+        return;
+    s->next_report = now + s->progress_period;
+    solver_progress p;
+    p.seconds = now - s->progress_start;
+    p.nodes = s->nb_decisions;
+    p.depth = s->depth + s->comp_depth;
+    p.propagations_per_second = p.seconds > 0 ? s->nb_propagations / p.seconds : 0;
+    p.fraction = s->progress_weight > 0 ? s->progress_done : search_fraction(s);
+    s->progress(&p, s->progress_data);
+}
+
+static uint64_t count_component(solver s, uint first, uint nb);
+
+// Counts the solutions of the unknown squares among the nb squares of the component lists starting at first, which
+// don't depend on the other unknown squares
+static uint64_t count_part(solver s, uint first, uint nb) {
+    uint top = s->comp_size;
+    uint nb_comp = split_components(s, first, nb);
+    uint64_t nb_sol = 1;
+    double weight = s->progress_weight;  // Shared by the components
+    uint k = 0;
+    for (uint head = top; k < nb_comp && nb_sol > 0; k++, head += s->comp_cells[head] + 1) {
+        s->progress_weight = weight / nb_comp;
+        nb_sol = solver_count_mul(s, nb_sol, count_component(s, head + 1, s->comp_cells[head]));
+    }
+    if (nb_comp == 0 || k < nb_comp)  // Every square decided, or the components left are not counted
+        s->progress_done += nb_comp == 0 ? weight : weight * (nb_comp - k) / nb_comp;
+    s->progress_weight = weight;
+    s->comp_size = top;
+    return nb_sol;
+}
+
+// Makes the component of the nb squares of the component lists starting at first the one being searched
+static void set_scope(solver s, uint first, uint nb) {
+    if (++s->scope_id == 0) {
+        memset(s->scope, 0, s->nb_cells * sizeof(uint));
+        s->scope_id = 1;
+    }
+    for (uint k = 0; k < nb; k++)
+        s->scope[s->comp_cells[first + k]] = s->scope_id;
+}
+
+// Whether a count has to give up at its deadline, which sets count_aborted (the clock is checked every 64 decisions)
+static bool count_interrupted(solver s) {
+    if (!s->count_aborted && s->count_deadline != 0 && s->nb_decisions % 64 == 0 && solver_now() >= s->count_deadline)
+        s->count_aborted = true;
+    return s->count_aborted;
+}
+
+// Counts the solutions of a component: decides one of its squares and counts both branches (the components met below
+// change the scope, which is set again before each branch)
+static uint64_t count_component(solver s, uint first, uint nb) {
+    if (count_interrupted(s))
+        return 0;
+    uint key = UINT32_MAX, size = 0;
+    uint64_t hash = 0;
+    double weight = s->progress_weight;  // Split between the two branches
+    if (s->caching) {
+        size = cache_make_key(s, first, nb);
+        hash = cache_hash(s->cache_key, size);
+        cache_entry *e = cache_find(s, s->cache_key, size, hash);
+        if (e->size != 0) {
+            s->progress_done += weight;
+            return e->count;
+        }
+        key = cache_keep_key(s, size);
+    }
+
+    set_scope(s, first, nb);
+    uint cell = s->heuristic(s);
+    s->nb_decisions++;
+    report(s);
+    s->comp_depth++;
+
+    uint64_t nb_sol = 0;
+    cell_value values[] = {SOLVER_TENT, SOLVER_GRASS};
+    for (uint v = 0; v < 2; v++) {
+        uint mark = s->trail_size;
+        if (v > 0) {
+            set_scope(s, first, nb);
+            s->nb_backtracks++;
+        }
+        solver_assign(s, cell, values[v]);
+        bool ok = solver_propagate(s);
+        if (ok && s->probing)
+            ok = solver_probe(s);
+        s->progress_weight = weight / 2;
+        if (ok)
+            nb_sol = solver_count_add(s, nb_sol, count_part(s, first, nb));
+        else
+            s->progress_done += weight / 2;
+        solver_undo(s, mark);
+    }
+    s->progress_weight = weight;
+    s->comp_depth--;
+
+    if (key != UINT32_MAX && !s->count_aborted)  // The count of a component given up is only partial
+        cache_insert(s, key, size, hash, nb_sol);
+    return nb_sol;
+}
+
+// Counts all the solutions with the component decomposition (from a propagated state)
+static uint64_t count_components(solver s) {
+    bool learning = s->learning;
+    s->learning = false;
+    s->comp_size = 0;
+    if (!s->keep_cache)
+        solver_clear_cache(s);
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (s->value[c] == SOLVER_UNKNOWN)
+            comp_push(s, c);
+    s->progress_done = 0;
+    s->progress_weight = 1;
+    uint64_t nb_sol = count_part(s, 0, s->comp_size);
+    s->progress_weight = 0;
+    s->scope_id = 0;
+    s->learning = learning;
+    return nb_sol;
+}
+
+/* ************************************************************************** */
+/*                                 SAMPLING                                   */
+/* ************************************************************************** */
+
+/* A solution is drawn uniformly by deciding the squares one by one: each value of the square chosen by the heuristic
+ * is kept with a probability proportional to the number of solutions of its branch, counted like count_component
+ * does. The components are independent, so each one is drawn on its own with the counts of its own solutions, which
+ * keeps the counts small (the cache of count_component is shared by all the counts of the draw).
+ */
+
+// splitmix64: every state, 0 included, gives a sequence of good quality
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t solver_random(uint64_t *state, uint64_t n) {
+    assert(n > 0);
+    uint64_t bound = UINT64_MAX - UINT64_MAX % n, r;
+    do
+        r = next_random(state);
+    while (r >= bound);
+    return r % n;
+}
+
+static bool sample_component(solver s, uint first, uint nb, uint64_t *rng);
+
+// Draws the unknown squares among the nb squares of the component lists starting at first, component by component
+static bool sample_part(solver s, uint first, uint nb, uint64_t *rng) {
+    uint top = s->comp_size;
+    uint nb_comp = split_components(s, first, nb);
+    bool ok = true;
+    for (uint k = 0, head = top; k < nb_comp && ok; k++, head += s->comp_cells[head] + 1)
+        ok = sample_component(s, head + 1, s->comp_cells[head], rng);
+    s->comp_size = top;
+    return ok;
+}
+
+// Draws a solution of a component: counts both branches of one of its squares, keeps one of them and draws the rest
+static bool sample_component(solver s, uint first, uint nb, uint64_t *rng) {
+    set_scope(s, first, nb);
+    uint cell = s->heuristic(s);
+    s->nb_decisions++;
+
+    uint64_t nb_sol[2] = {0, 0};
+    cell_value values[] = {SOLVER_TENT, SOLVER_GRASS};
+    for (uint v = 0; v < 2; v++) {
+        uint mark = s->trail_size;
+        if (v > 0)
+            set_scope(s, first, nb);
+        solver_assign(s, cell, values[v]);
+        bool ok = solver_propagate(s);
+        if (ok && s->probing)
+            ok = solver_probe(s);
+        if (ok)
+            nb_sol[v] = count_part(s, first, nb);
+        solver_undo(s, mark);
+    }
+    if (nb_sol[0] == 0 && nb_sol[1] == 0)
+        return false;
+
+    if (nb_sol[0] > UINT64_MAX - nb_sol[1]) {  // Keeps the ratio of the counts with a sum in 64 bits
+        nb_sol[0] /= 2;
+        nb_sol[1] /= 2;
+    }
+    uint v = solver_random(rng, nb_sol[0] + nb_sol[1]) < nb_sol[0] ? 0 : 1;
+    set_scope(s, first, nb);  // Propagated in the same scope as when it was counted
+    solver_assign(s, cell, values[v]);
+    bool ok = solver_propagate(s);
+    if (ok && s->probing)
+        ok = solver_probe(s);
+    assert(ok);  // The branch has solutions
+    return sample_part(s, first, nb, rng);
+}
+
+bool solver_sample(solver s, uint64_t *rng) {
+    assert(s && rng && s->modulus == 0);
+    uint root = s->trail_size;
+    bool ok = solver_prepare(s);
+    if (ok && s->probing)
+        ok = solver_probe(s);
+    if (ok) {
+        bool learning = s->learning;
+        s->learning = false;
+        s->comp_size = 0;
+        solver_clear_cache(s);
+        for (uint c = 0; c < s->nb_cells; c++)
+            if (s->value[c] == SOLVER_UNKNOWN)
+                comp_push(s, c);
+        ok = sample_part(s, 0, s->comp_size, rng);
+        s->scope_id = 0;
+        s->learning = learning;
+    }
+    if (!ok)
+        solver_undo(s, root);
+    return ok;
+}
+
+/* ************************************************************************** */
+/*                                ESTIMATION                                  */
+/* ************************************************************************** */
+
+/* Knuth's estimator: a probe goes down the search tree along random decisions, each one taken among the values not
+ * refuted by the propagation, and multiplies the numbers of values left on its way. The product is an unbiased
+ * estimate of the number of solutions. The components are estimated on their own (the estimate of the board is the
+ * product of theirs) and the components of at most EXACT_SQUARES squares are counted exactly, which removes most of
+ * the spread of the estimates: only the large components are left to chance.
+ */
+
+#define EXACT_SQUARES 32
+
+static double estimate_component(solver s, uint first, uint nb, uint64_t *rng);
+
+// Estimates the unknown squares among the nb squares of the component lists starting at first (log2, -1 for none)
+static double estimate_part(solver s, uint first, uint nb, uint64_t *rng) {
+    uint top = s->comp_size;
+    uint nb_comp = split_components(s, first, nb);
+    double log_nb = 0;
+    for (uint k = 0, head = top; k < nb_comp && log_nb >= 0; k++, head += s->comp_cells[head] + 1) {
+        double e = estimate_component(s, head + 1, s->comp_cells[head], rng);
+        log_nb = e < 0 ? -1 : log_nb + e;
+    }
+    s->comp_size = top;
+    return log_nb;
+}
+
+// Estimates a component: takes one of the values of one of its squares not refuted by the propagation at random
+static double estimate_component(solver s, uint first, uint nb, uint64_t *rng) {
+    if (nb <= EXACT_SQUARES) {
+        uint64_t nb_sol = count_component(s, first, nb);
+        return nb_sol == 0 ? -1 : log2((double)nb_sol);
+    }
+    uint mark = s->trail_size;
+    set_scope(s, first, nb);
+    uint cell = s->heuristic(s);
+    s->nb_decisions++;
+
+    bool viable[2];
+    cell_value values[] = {SOLVER_TENT, SOLVER_GRASS};
+    for (uint v = 0; v < 2; v++) {
+        set_scope(s, first, nb);
+        solver_assign(s, cell, values[v]);
+        viable[v] = solver_propagate(s) && (!s->probing || solver_probe(s));
+        solver_undo(s, mark);
+    }
+    if (!viable[0] && !viable[1])
+        return -1;
+
+    uint v = viable[0] && viable[1] ? solver_random(rng, 2) : viable[1];
+    set_scope(s, first, nb);
+    solver_assign(s, cell, values[v]);
+    solver_propagate(s);
+    if (s->probing)
+        solver_probe(s);
+    double e = estimate_part(s, first, nb, rng);
+    solver_undo(s, mark);
+    return e < 0 ? -1 : e + (viable[0] && viable[1]);
+}
+
+double solver_estimate(solver s, uint64_t *rng) {
+    assert(s && rng && s->modulus == 0);
+    uint root = s->trail_size;
+    double log_nb = -1;
+    bool ok = solver_prepare(s);
+    if (ok && s->probing)
+        ok = solver_probe(s);
+    if (ok) {
+        bool learning = s->learning;
+        s->learning = false;
+        s->comp_size = 0;
+        for (uint c = 0; c < s->nb_cells; c++)
+            if (s->value[c] == SOLVER_UNKNOWN)
+                comp_push(s, c);
+        log_nb = estimate_part(s, 0, s->comp_size, rng);
+        s->scope_id = 0;
+        s->learning = learning;
+    }
+    solver_undo(s, root);
+    return log_nb;
+}
+
+/* ************************************************************************** */
+/*                                  SEARCH                                    */
+/* ************************************************************************** */
+
+uint solver_choose_first(solver s) {
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (s->value[c] == SOLVER_UNKNOWN && in_scope(s, c))
+            return c;
+    assert(false);
+    return 0;
+}
+
+// Degree of an unknown square in the conflict graph: unknown squares it would turn to grass and trees it would satisfy
+static uint conflict_degree(solver s, uint cell) {
+    uint degree = 0;
+    for (uint k = 0; k < s->cell_nb_conf[cell]; k++)
+        if (s->value[s->cell_conf[cell * MAX_CONF + k]] == SOLVER_UNKNOWN)
+            degree++;
+    for (uint k = 0; k < s->cell_nb_tree[cell]; k++)
+        if (s->tree_tents[s->cell_tree[cell * MAX_TREES + k]] == 0)
+            degree++;
+    return degree;
+}
+
+// Keeps the unknown square of higher conflict degree between cell and *best
+static void keep_best_degree(solver s, uint cell, uint *best, int *best_degree) {
+    if (s->value[cell] != SOLVER_UNKNOWN)
+        return;
+    int degree = conflict_degree(s, cell);
+    if (degree > *best_degree) {
+        *best = cell;
+        *best_degree = degree;
+    }
+}
+
+// Maximum number of tents the unknown squares of a line can still hold (no two tents side by side)
+static uint line_capacity(solver s, uint first, uint step, uint len, bool cyclic) {
+    uint capacity = 0, run = 0, first_run = 0;
+    bool first_done = false;
+    for (uint k = 0; k < len; k++) {
+        if (s->value[first + k * step] == SOLVER_UNKNOWN) {
+            run++;
+            continue;
+        }
+        if (!first_done)
+            first_run = run, first_done = true;
+        else
+            capacity += (run + 1) / 2;
+        run = 0;
+    }
+    if (!first_done)  // The whole line is unknown
+        return cyclic ? len / 2 : (len + 1) / 2;
+    if (cyclic)  // The last run goes on with the first one
+        return capacity + (run + first_run + 1) / 2;
+    return capacity + (run + 1) / 2 + (first_run + 1) / 2;
+}
+
+/* The most constrained object is either a tree without tent (its domain is its number of unknown squares) or a line
+ * still expecting tents (its domain is its slack plus one, the slack being the number of tents its unknown squares
+ * can still hold minus the number of tents it expects). Lines come second on a tie.
+ * The square decided is the unknown square of that object with the highest conflict degree.
+ */
+uint solver_choose_mrv(solver s) {
+    uint best_size = UINT32_MAX, first = 0, step = 0, len = 0;
+    int best_tree = -1;
+
+    for (uint t = 0; t < s->nb_trees; t++)
+        if (s->tree_tents[t] == 0 && s->tree_free[t] > 0 && s->tree_free[t] < best_size && tree_in_scope(s, t)) {
+            best_size = s->tree_free[t];
+            best_tree = t;
+        }
+    for (uint i = 0; i < s->nb_rows; i++)
+        if (s->row_free[i] > 0 && s->row_tents[i] < s->row_need[i] && line_in_scope(s, i * s->nb_cols, 1, s->nb_cols)) {
+            uint capacity = line_capacity(s, i * s->nb_cols, 1, s->nb_cols, s->wrapping);
+            uint need = s->row_need[i] - s->row_tents[i];
+            uint size = capacity < need ? 0 : capacity - need + 1;
+            if (size < best_size) {
+                best_size = size;
+                best_tree = -1;
+                first = i * s->nb_cols, step = 1, len = s->nb_cols;
+            }
+        }
+    for (uint j = 0; j < s->nb_cols; j++)
+        if (s->col_free[j] > 0 && s->col_tents[j] < s->col_need[j] && line_in_scope(s, j, s->nb_cols, s->nb_rows)) {
+            uint capacity = line_capacity(s, j, s->nb_cols, s->nb_rows, s->wrapping);
+            uint need = s->col_need[j] - s->col_tents[j];
+            uint size = capacity < need ? 0 : capacity - need + 1;
+            if (size < best_size) {
+                best_size = size;
+                best_tree = -1;
+                first = j, step = s->nb_cols, len = s->nb_rows;
+            }
+        }
+
+    uint best = 0;
+    int best_degree = -1;
+    if (best_tree >= 0)
+        for (uint k = 0; k < s->tree_nb_cand[best_tree]; k++)
+            keep_best_degree(s, s->tree_cand[best_tree * MAX_TREES + k], &best, &best_degree);
+    else if (len > 0)
+        for (uint k = 0; k < len; k++)
+            keep_best_degree(s, first + k * step, &best, &best_degree);
+    else  // Every tree and line is satisfied: the unknown squares left only have to become grass
+        return solver_choose_first(s);
+    return best;
+}
+
+// Goes back to the last decision whose second branch is left and takes it. Returns false if there is none.
+static bool backtrack(solver s, uint root) {
+    while (s->depth > 0 && s->decisions[s->depth - 1].second)
+        s->depth--;
+    if (s->depth == 0) {
+        solver_undo(s, root);
+        return false;
+    }
+    decision *d = &s->decisions[s->depth - 1];
+    solver_undo(s, d->mark);
+    d->second = true;
+    solver_assign(s, d->cell, SOLVER_GRASS);
+    s->nb_backtracks++;
+    return true;
+}
+
+bool solver_interrupted(solver s) {
+    if (s->stop != NULL && __atomic_load_n(s->stop, __ATOMIC_RELAXED))
+        return true;
+    if (s->cancel != NULL && __atomic_load_n(s->cancel, __ATOMIC_RELAXED)) {
+        if (s->stop != NULL)
+            __atomic_store_n(s->stop, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    if (s->max_decisions != 0 && s->nb_decisions >= s->max_decisions)
+        s->out_of_limits = true;
+    else if (s->nb_decisions % 64 == 0 && s->max_memory != 0 && solver_memory(s) > s->max_memory)
+        s->out_of_limits = true;
+    else if (s->nb_decisions % 64 == 0 && s->deadline != 0 && solver_now() >= s->deadline)
+        s->out_of_time = true;
+    else
+        return false;
+    if (s->stop != NULL)
+        __atomic_store_n(s->stop, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/* Without learning, the search is a depth-first search: a contradiction (or a solution) sends it back to the last
+ * decision whose second branch is left. With learning, every contradiction adds its nogood. When a single solution is
+ * wanted, the search then jumps back to the highest level of the other facts of the nogood, where it forces the square
+ * of the unique implication point, instead of trying the second branches in between. Counting keeps the depth-first
+ * order, so that no solution is counted twice, and only keeps the short nogoods to propagate them.
+ * Counting with the component decomposition is done by count_components instead.
+ */
+uint64_t solver_search(solver s, uint64_t limit) {
+    assert(s);
+    uint root = s->trail_size;
+    uint64_t nb_sol = 0;
+    bool ok = solver_prepare(s);
+    if (limit == 0 && s->components && s->on_solution == NULL) {
+        if (ok && s->probing)
+            ok = solver_probe(s);
+        nb_sol = ok ? count_components(s) : 0;
+        solver_undo(s, root);
+        return nb_sol;
+    }
+
+    while (true) {
+        if (ok && s->probing && s->nb_free > 0)
+            ok = solver_probe(s);
+
+        if (ok && s->nb_free == 0) {  // Every square is decided: this is a solution
+            nb_sol++;
+            if (s->on_solution != NULL && !s->on_solution(s, s->on_solution_data)) {  // Stopped by the caller
+                s->depth = 0;
+                solver_undo(s, root);
+                return nb_sol;
+            }
+            if (limit != 0 && nb_sol >= limit)
+                return nb_sol;
+            ok = false;
+            s->conflict = NO_REASON;
+        }
+
+        if (!ok) {
+            bool learnt = false;
+            if (s->learning && s->conflict != NO_REASON) {
+                uint rec = s->conflict, lvl = record_level(s, rec);
+                s->conflict = NO_REASON;
+                if (lvl == 0) {  // The contradiction holds at the root: there is no solution left
+                    s->depth = 0;
+                    solver_undo(s, root);
+                    return nb_sol;
+                }
+                analyze(s, rec, lvl, false);
+                learnt = true;
+            }
+            if (learnt && limit == 1) {
+                s->depth = s->learnt_level;
+                solver_undo(s, s->decisions[s->depth].mark);
+                s->nb_backtracks++;
+            } else if (!backtrack(s, root))
+                return nb_sol;
+            ok = !learnt || learn(s, limit == 1 ? UINT32_MAX : MAX_COUNTING_NOGOOD);
+        } else {
+            if (limit != 0 ? solver_interrupted(s) : count_interrupted(s)) {
+                s->depth = 0;
+                solver_undo(s, root);
+                return nb_sol;
+            }
+            decision *d = &s->decisions[s->depth++];
+            d->cell = s->heuristic(s);
+            d->mark = s->trail_size;
+            d->second = false;
+            solver_assign(s, d->cell, SOLVER_TENT);
+            s->nb_decisions++;
+            report(s);
+        }
+        ok = ok && solver_propagate(s);
+    }
+}
+
+void solver_export(solver s, game g) {
+    assert(s && g && s->nb_free == 0);
+    for (uint c = 0; c < s->nb_cells; c++) {
+        uint i = c / s->nb_cols, j = c % s->nb_cols;
+        if (!check_square_tree(g, i, j))
+            game_set_square(g, i, j, s->value[c] == SOLVER_TENT ? TENT : EMPTY);
+    }
+}
+
+void solver_export_partial(solver s, game g) {
+    assert(s && g);
+    for (uint c = 0; c < s->nb_cells; c++) {
+        uint i = c / s->nb_cols, j = c % s->nb_cols;
+        if (!check_square_tree(g, i, j))
+            game_set_square(g, i, j, s->value[c] == SOLVER_TENT ? TENT : s->value[c] == SOLVER_GRASS ? GRASS : EMPTY);
+    }
+}
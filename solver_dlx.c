@@ -0,0 +1,307 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "header/solver.h"
+
+#define LOG_HIDE 0        // An option was hidden
+#define LOG_DEACTIVATE 1  // An item left the list of the items still expecting tents
+#define LOG_NEED 2        // The number of tents expected by an item went down
+
+/* The puzzle as a covering problem with dancing links: every unknown square is an option (a tent on it), and the rows,
+ * the columns and the trees without tent are the items an option covers. A row or a column must be covered exactly
+ * as many times as it expects tents, a tree at least once (a tent may touch several trees, so the trees are not paired
+ * with the tents and exact cover only holds for the lines). Choosing an option hides the options in conflict with it.
+ *
+ * Items and options are in doubly linked lists, so that hiding an option (unlinking it from the lists of its items) and
+ * restoring it both take a constant time per item. Every change is logged so that it can be undone in reverse order.
+ */
+typedef struct dlx_s {
+    solver s;
+    uint nb_items, nb_options;
+    uint *option_cell, *cell_option;  // Square of each option, and option of each unknown square
+    uint *need, *len;                 // Tents an item still expects, and options left in its list
+    bool *is_tree;                    // Trees only need one tent
+    uint *left, *right;               // Items still expecting tents (item nb_items is the head of the list)
+    uint *up, *down;                  // Nodes: the first nb_items are the heads of the lists of options of the items
+    uint *node_item, *node_option;
+    uint *first_node, *nb_nodes;      // Nodes of each option
+    bool *hidden;
+    uint *log, log_size;
+    uint *chosen, nb_chosen;
+} dlx_s;
+
+typedef dlx_s *dlx;
+
+/* ************************************************************************** */
+/*                              CREATE / DELETE                               */
+/* ************************************************************************** */
+
+// Adds a node of option o at the end of the list of item
+static void add_node(dlx d, uint *nb, uint item, uint o) {
+    uint n = (*nb)++;
+    d->node_item[n] = item;
+    d->node_option[n] = o;
+    d->up[n] = d->up[item];
+    d->down[n] = item;
+    d->down[d->up[item]] = n;
+    d->up[item] = n;
+    d->len[item]++;
+}
+
+// Builds the covering problem of the current state of the solver
+static dlx dlx_new(solver s) {
+    dlx d = calloc(1, sizeof(dlx_s));
+    assert(d);
+    d->s = s;
+    d->nb_items = s->nb_rows + s->nb_cols + s->nb_trees;
+    uint max_nodes = d->nb_items + (2 + MAX_TREES) * s->nb_cells;
+
+    d->option_cell = malloc(s->nb_cells * sizeof(uint));
+    d->cell_option = malloc(s->nb_cells * sizeof(uint));
+    d->need = calloc(d->nb_items, sizeof(uint));
+    d->len = calloc(d->nb_items, sizeof(uint));
+    d->is_tree = calloc(d->nb_items, sizeof(bool));
+    d->left = malloc((d->nb_items + 1) * sizeof(uint));
+    d->right = malloc((d->nb_items + 1) * sizeof(uint));
+    d->up = malloc(max_nodes * sizeof(uint));
+    d->down = malloc(max_nodes * sizeof(uint));
+    d->node_item = malloc(max_nodes * sizeof(uint));
+    d->node_option = malloc(max_nodes * sizeof(uint));
+    d->first_node = malloc(s->nb_cells * sizeof(uint));
+    d->nb_nodes = calloc(s->nb_cells, sizeof(uint));
+    d->hidden = calloc(s->nb_cells, sizeof(bool));
+    d->log = malloc(4 * max_nodes * sizeof(uint));
+    d->chosen = malloc(s->nb_cells * sizeof(uint));
+    assert(d->option_cell && d->cell_option && d->need && d->len && d->is_tree && d->left && d->right && d->up);
+    assert(d->down && d->node_item && d->node_option && d->first_node && d->nb_nodes && d->hidden && d->log && d->chosen);
+
+    for (uint c = 0; c < s->nb_cells; c++)
+        d->cell_option[c] = UINT32_MAX;
+
+    // Items: the rows, then the columns, then the trees
+    for (uint i = 0; i < s->nb_rows; i++)
+        d->need[i] = s->row_tents[i] <= s->row_need[i] ? s->row_need[i] - s->row_tents[i] : UINT32_MAX;
+    for (uint j = 0; j < s->nb_cols; j++)
+        d->need[s->nb_rows + j] = s->col_tents[j] <= s->col_need[j] ? s->col_need[j] - s->col_tents[j] : UINT32_MAX;
+    for (uint t = 0; t < s->nb_trees; t++) {
+        d->is_tree[s->nb_rows + s->nb_cols + t] = true;
+        d->need[s->nb_rows + s->nb_cols + t] = s->tree_tents[t] == 0;
+    }
+    uint last = d->nb_items;
+    d->left[last] = d->right[last] = last;
+    for (uint i = 0; i < d->nb_items; i++) {
+        d->up[i] = d->down[i] = i;
+        if (d->need[i] > 0) {
+            d->left[i] = last;
+            d->right[i] = d->nb_items;
+            d->right[last] = i;
+            d->left[d->nb_items] = i;
+            last = i;
+        }
+    }
+
+    // Options, in the order of the squares (a tent can't go next to a tent or on a square in conflict with itself)
+    uint nb = d->nb_items;
+    for (uint c = 0; c < s->nb_cells; c++) {
+        if (s->value[c] != SOLVER_UNKNOWN)
+            continue;
+        bool allowed = true;
+        for (uint k = 0; k < s->cell_nb_conf[c]; k++)
+            allowed &= s->cell_conf[c * MAX_CONF + k] != c && s->value[s->cell_conf[c * MAX_CONF + k]] != SOLVER_TENT;
+        if (!allowed)
+            continue;
+        uint o = d->nb_options++;
+        d->option_cell[o] = c;
+        d->cell_option[c] = o;
+        d->first_node[o] = nb;
+        add_node(d, &nb, c / s->nb_cols, o);
+        add_node(d, &nb, s->nb_rows + c % s->nb_cols, o);
+        for (uint k = 0; k < s->cell_nb_tree[c]; k++)
+            add_node(d, &nb, s->nb_rows + s->nb_cols + s->cell_tree[c * MAX_TREES + k], o);
+        d->nb_nodes[o] = nb - d->first_node[o];
+    }
+    return d;
+}
+
+static void dlx_delete(dlx d) {
+    free(d->option_cell);
+    free(d->cell_option);
+    free(d->need);
+    free(d->len);
+    free(d->is_tree);
+    free(d->left);
+    free(d->right);
+    free(d->up);
+    free(d->down);
+    free(d->node_item);
+    free(d->node_option);
+    free(d->first_node);
+    free(d->nb_nodes);
+    free(d->hidden);
+    free(d->log);
+    free(d->chosen);
+    free(d);
+}
+
+/* ************************************************************************** */
+/*                               DANCING LINKS                                */
+/* ************************************************************************** */
+
+// Unlinks option o from the lists of its items
+static void hide(dlx d, uint o) {
+    if (d->hidden[o])
+        return;
+    d->hidden[o] = true;
+    for (uint n = d->first_node[o]; n < d->first_node[o] + d->nb_nodes[o]; n++) {
+        d->down[d->up[n]] = d->down[n];
+        d->up[d->down[n]] = d->up[n];
+        d->len[d->node_item[n]]--;
+    }
+    d->log[d->log_size++] = o;
+    d->log[d->log_size++] = LOG_HIDE;
+}
+
+// Removes item i from the list of the items still expecting tents
+static void deactivate(dlx d, uint i) {
+    d->right[d->left[i]] = d->right[i];
+    d->left[d->right[i]] = d->left[i];
+    d->log[d->log_size++] = i;
+    d->log[d->log_size++] = LOG_DEACTIVATE;
+}
+
+// Undoes the changes logged after the log had mark elements
+static void undo(dlx d, uint mark) {
+    while (d->log_size > mark) {
+        uint kind = d->log[--d->log_size];
+        uint x = d->log[--d->log_size];
+        if (kind == LOG_HIDE) {
+            d->hidden[x] = false;
+            for (uint n = d->first_node[x] + d->nb_nodes[x]; n-- > d->first_node[x];) {
+                d->down[d->up[n]] = n;
+                d->up[d->down[n]] = n;
+                d->len[d->node_item[n]]++;
+            }
+        } else if (kind == LOG_DEACTIVATE) {
+            d->right[d->left[x]] = x;
+            d->left[d->right[x]] = x;
+        } else
+            d->need[x]++;
+    }
+}
+
+// Puts a tent on the square of option o
+static void choose(dlx d, uint o) {
+    solver s = d->s;
+    uint c = d->option_cell[o];
+    hide(d, o);
+    d->chosen[d->nb_chosen++] = o;
+
+    for (uint n = d->first_node[o]; n < d->first_node[o] + d->nb_nodes[o]; n++) {
+        uint i = d->node_item[n];
+        if (d->need[i] == 0)  // A tree already touching a tent
+            continue;
+        d->need[i]--;
+        d->log[d->log_size++] = i;
+        d->log[d->log_size++] = LOG_NEED;
+        if (d->need[i] > 0)
+            continue;
+        deactivate(d, i);
+        if (!d->is_tree[i])  // The line is full: its other squares are grass
+            while (d->down[i] != i)
+                hide(d, d->node_option[d->down[i]]);
+    }
+
+    for (uint k = 0; k < s->cell_nb_conf[c]; k++) {
+        uint other = s->cell_conf[c * MAX_CONF + k];
+        if (s->value[other] == SOLVER_UNKNOWN && d->cell_option[other] != UINT32_MAX)
+            hide(d, d->cell_option[other]);
+    }
+}
+
+/* ************************************************************************** */
+/*                                  SEARCH                                    */
+/* ************************************************************************** */
+
+// Whether the search for solutions was interrupted by another thread or by its budget
+static bool stopped(dlx d, uint64_t limit) {
+    return limit != 0 && solver_interrupted(d->s);
+}
+
+/* The item branched on is the one with the fewest options to spare. Its branches are "option o is the first option of
+ * its list that gets a tent": the options before o are hidden in the branch of o. The branches are disjoint and cover
+ * every solution, so that each solution is found exactly once.
+ */
+static uint64_t count(dlx d, uint64_t limit, uint64_t found) {
+    if (stopped(d, limit))
+        return 0;
+    uint best = d->nb_items, best_slack = UINT32_MAX;
+    for (uint i = d->right[d->nb_items]; i != d->nb_items; i = d->right[i]) {
+        if (d->len[i] < d->need[i]) {  // Not enough options left to cover the item
+            d->s->nb_conflicts++;
+            return 0;
+        }
+        if (d->len[i] - d->need[i] < best_slack) {
+            best = i;
+            best_slack = d->len[i] - d->need[i];
+        }
+    }
+    if (best == d->nb_items)  // Every item is covered: the squares left are grass
+        return 1;
+
+    uint64_t nb_sol = 0;
+    uint mark = d->log_size;
+    while (d->len[best] >= d->need[best]) {
+        uint o = d->node_option[d->down[best]];
+        uint branch = d->log_size;
+        choose(d, o);
+        d->s->nb_decisions++;
+        nb_sol += count(d, limit, found + nb_sol);
+        if (limit != 0 && found + nb_sol >= limit)  // The solution is kept for the caller
+            return nb_sol;
+        undo(d, branch);
+        d->nb_chosen--;
+        d->s->nb_backtracks++;
+        if (stopped(d, limit))
+            break;
+        hide(d, o);
+    }
+    undo(d, mark);
+    return nb_sol;
+}
+
+/* Every row and column that already has its tents gets grass on its other squares before the search (lines with too
+ * many tents expect UINT32_MAX more, so that they can't be covered). When the limit is reached, the tents chosen are
+ * copied into the solver.
+ */
+uint64_t solver_dlx_search(solver s, uint64_t limit) {
+    assert(s);
+    uint sum_rows = 0, sum_cols = 0;
+    for (uint i = 0; i < s->nb_rows; i++)
+        sum_rows += s->row_need[i];
+    for (uint j = 0; j < s->nb_cols; j++)
+        sum_cols += s->col_need[j];
+    if (sum_rows != s->nb_trees || sum_cols != s->nb_trees)  // Same necessary condition as the native search
+        return 0;
+    for (uint c = 0; c < s->nb_cells; c++)  // Tents already placed must not be in conflict
+        for (uint k = 0; s->value[c] == SOLVER_TENT && k < s->cell_nb_conf[c]; k++)
+            if (s->value[s->cell_conf[c * MAX_CONF + k]] == SOLVER_TENT)
+                return 0;
+
+    dlx d = dlx_new(s);
+    for (uint i = 0; i < s->nb_rows + s->nb_cols; i++)
+        if (d->need[i] == 0)
+            while (d->down[i] != i)
+                hide(d, d->node_option[d->down[i]]);
+    uint64_t nb_sol = count(d, limit, 0);
+
+    if (limit != 0 && nb_sol >= limit) {
+        for (uint k = 0; k < d->nb_chosen; k++)
+            solver_assign(s, d->option_cell[d->chosen[k]], SOLVER_TENT);
+        for (uint c = 0; c < s->nb_cells; c++)
+            if (s->value[c] == SOLVER_UNKNOWN)
+                solver_assign(s, c, SOLVER_GRASS);
+    }
+    dlx_delete(d);
+    return nb_sol;
+}
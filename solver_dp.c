@@ -0,0 +1,486 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header/solver.h"
+
+// Maximum number of states kept between two lines, beyond which the count is left to the search
+#define MAX_STATES (1u << 19)
+
+/* Counting by dynamic programming over the lines of the narrow side of the board (the rows, or the columns when the
+ * board is wider than high). The lines are filled one after the other with tent patterns, a pattern being a mask of
+ * the squares of the line. After a line, the part of the board already filled only matters to the next lines through
+ * a state made of:
+ *      -> the pattern of the line (the tents of the next line must not be in conflict with it),
+ *      -> the trees of the line without tent yet (the next line must give them one),
+ *      -> the number of tents in each crossing line (rows for columns and conversely).
+ * When the board wraps around along its lines, the first line is next to the last one: its pattern and its trees left
+ * without tent by the first two lines are kept in the state until the end.
+ * The number of ways to reach each state is kept in a hash table, so that each state is only extended once.
+ */
+
+/**
+ * @brief States reached after a line, with the number of ways to reach each of them.
+ **/
+typedef struct table_s {
+    uint key_size;
+    uint *keys;          // Keys of the states, one after the other
+    uint64_t *counts;
+    uint nb, capacity;
+    uint *slots;         // Open addressing table of state numbers plus one (0 for a free slot)
+    uint nb_slots;
+} table_s;
+
+typedef table_s *table;
+
+typedef struct dp_s {
+    solver s;
+    bool transposed;             // The lines are the columns
+    uint nb_lines, width;
+    uint *cross_need, *cross_left;  // Tents expected by each crossing line, and squares left to it after each line
+    uint *tree_mask;             // Trees of each line
+    uint *patterns, nb_patterns, patterns_capacity;  // Patterns of the current line (PATTERN_SIZE values each)
+} dp_s;
+
+typedef dp_s *dp;
+
+/* ************************************************************************** */
+/*                                  TABLE                                     */
+/* ************************************************************************** */
+
+#define PATTERN_MASK 0       // Tents of the pattern
+#define PATTERN_CONFLICTS 1  // Squares of the line before in conflict with them
+#define PATTERN_COVER 2      // Trees of the line before next to them
+#define PATTERN_COVER_SELF 3 // Trees of the line next to them
+#define PATTERN_SIZE 4
+
+#define KEY_MASK 0          // Pattern of the last line
+#define KEY_PENDING 1       // Trees of the last line still without tent
+#define KEY_FIRST 2         // Pattern of the first line (when the board wraps around)
+#define KEY_FIRST_PENDING 3 // Trees of the first line without tent after the second line (idem)
+#define KEY_COUNTS 4        // Tents of each crossing line
+
+static table table_new(uint key_size) {
+    table t = malloc(sizeof(table_s));
+    assert(t);
+    t->key_size = key_size;
+    t->nb = 0;
+    t->capacity = 1024;
+    t->nb_slots = 2048;
+    t->keys = malloc(t->capacity * key_size * sizeof(uint));
+    t->counts = malloc(t->capacity * sizeof(uint64_t));
+    t->slots = calloc(t->nb_slots, sizeof(uint));
+    assert(t->keys && t->counts && t->slots);
+    return t;
+}
+
+static void table_delete(table t) {
+    free(t->keys);
+    free(t->counts);
+    free(t->slots);
+    free(t);
+}
+
+static void table_clear(table t) {
+    t->nb = 0;
+    memset(t->slots, 0, t->nb_slots * sizeof(uint));
+}
+
+static uint64_t key_hash(const uint *key, uint size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (uint k = 0; k < size; k++)
+        h = (h ^ key[k]) * 1099511628211ULL;
+    return h ^ (h >> 29);
+}
+
+// Slot of a key in the table, or the free slot where it would go
+static uint table_slot(table t, const uint *key) {
+    uint mask = t->nb_slots - 1;
+    for (uint slot = key_hash(key, t->key_size) & mask;; slot = (slot + 1) & mask) {
+        uint x = t->slots[slot];
+        if (x == 0 || memcmp(t->keys + (x - 1) * t->key_size, key, t->key_size * sizeof(uint)) == 0)
+            return slot;
+    }
+}
+
+// Adds count ways to reach the state of the key
+static void table_add(solver s, table t, const uint *key, uint64_t count) {
+    uint slot = table_slot(t, key);
+    if (t->slots[slot] != 0) {
+        t->counts[t->slots[slot] - 1] = solver_count_add(s, t->counts[t->slots[slot] - 1], count);
+        return;
+    }
+    if (t->nb == t->capacity) {
+        t->capacity *= 2;
+        t->keys = realloc(t->keys, t->capacity * t->key_size * sizeof(uint));
+        t->counts = realloc(t->counts, t->capacity * sizeof(uint64_t));
+        assert(t->keys && t->counts);
+    }
+    memcpy(t->keys + t->nb * t->key_size, key, t->key_size * sizeof(uint));
+    t->counts[t->nb++] = count;
+    t->slots[slot] = t->nb;
+
+    if (2 * t->nb > t->nb_slots) {  // Kept at most half full
+        free(t->slots);
+        t->nb_slots *= 2;
+        t->slots = calloc(t->nb_slots, sizeof(uint));
+        assert(t->slots);
+        for (uint x = 0; x < t->nb; x++)
+            t->slots[table_slot(t, t->keys + x * t->key_size)] = x + 1;
+    }
+}
+
+/* ************************************************************************** */
+/*                                  LINES                                     */
+/* ************************************************************************** */
+
+static uint line_cell(dp d, uint line, uint pos) {
+    return d->transposed ? pos * d->s->nb_cols + line : line * d->s->nb_cols + pos;
+}
+
+static uint cell_line(dp d, uint cell) {
+    return d->transposed ? cell % d->s->nb_cols : cell / d->s->nb_cols;
+}
+
+static uint cell_pos(dp d, uint cell) {
+    return d->transposed ? cell / d->s->nb_cols : cell % d->s->nb_cols;
+}
+
+static uint line_need(dp d, uint line) {
+    return d->transposed ? d->s->col_need[line] : d->s->row_need[line];
+}
+
+// Squares of line target in conflict with the tents of pattern mask on line
+static uint conflicts(dp d, uint line, uint mask, uint target) {
+    solver s = d->s;
+    uint out = 0;
+    for (uint p = 0; p < d->width; p++) {
+        if (!(mask >> p & 1))
+            continue;
+        uint c = line_cell(d, line, p);
+        for (uint k = 0; k < s->cell_nb_conf[c]; k++)
+            if (cell_line(d, s->cell_conf[c * MAX_CONF + k]) == target)
+                out |= 1u << cell_pos(d, s->cell_conf[c * MAX_CONF + k]);
+    }
+    return out;
+}
+
+// Trees of line target next to the tents of pattern mask on line
+static uint cover(dp d, uint line, uint mask, uint target) {
+    solver s = d->s;
+    uint out = 0;
+    for (uint p = 0; p < d->width; p++) {
+        if (!(mask >> p & 1))
+            continue;
+        uint c = line_cell(d, line, p);
+        for (uint k = 0; k < s->cell_nb_tree[c]; k++) {
+            uint tree = s->tree_cell[s->cell_tree[c * MAX_TREES + k]];
+            if (cell_line(d, tree) == target)
+                out |= 1u << cell_pos(d, tree);
+        }
+    }
+    return out;
+}
+
+// Adds the pattern mask to the patterns of line
+static void keep_pattern(dp d, uint line, uint mask) {
+    if (d->nb_patterns == d->patterns_capacity) {
+        d->patterns_capacity *= 2;
+        d->patterns = realloc(d->patterns, d->patterns_capacity * PATTERN_SIZE * sizeof(uint));
+        assert(d->patterns);
+    }
+    uint *pattern = d->patterns + d->nb_patterns++ * PATTERN_SIZE;
+    pattern[PATTERN_MASK] = mask;
+    pattern[PATTERN_CONFLICTS] = line > 0 ? conflicts(d, line, mask, line - 1) : 0;
+    pattern[PATTERN_COVER] = line > 0 ? cover(d, line, mask, line - 1) : 0;
+    pattern[PATTERN_COVER_SELF] = cover(d, line, mask, line);
+}
+
+// Enumerates the patterns of line with need tents from position pos, mask holding the tents already chosen (when the
+// solver has no pattern table for the width of the lines)
+static void add_patterns(dp d, uint line, uint pos, uint mask, uint need) {
+    if (need == 0 || pos == d->width) {
+        for (uint p = pos; p < d->width; p++)  // The tents already placed are part of every pattern
+            if (d->s->value[line_cell(d, line, p)] == SOLVER_TENT)
+                return;
+        if (need == 0)
+            keep_pattern(d, line, mask);
+        return;
+    }
+    cell_value v = d->s->value[line_cell(d, line, pos)];
+    uint bit = 1u << pos;
+    if (v != SOLVER_GRASS && !(conflicts(d, line, bit, line) & (mask | bit)))
+        add_patterns(d, line, pos + 1, mask | bit, need - 1);
+    if (v != SOLVER_TENT)
+        add_patterns(d, line, pos + 1, mask, need);
+}
+
+/* ************************************************************************** */
+/*                                  COUNT                                     */
+/* ************************************************************************** */
+
+static dp dp_new(solver s) {
+    dp d = malloc(sizeof(dp_s));
+    assert(d);
+    d->s = s;
+    d->transposed = s->nb_cols > s->nb_rows;
+    d->nb_lines = d->transposed ? s->nb_cols : s->nb_rows;
+    d->width = d->transposed ? s->nb_rows : s->nb_cols;
+    d->cross_need = malloc(d->width * sizeof(uint));
+    d->cross_left = calloc((d->nb_lines + 1) * d->width, sizeof(uint));
+    d->tree_mask = calloc(d->nb_lines, sizeof(uint));
+    d->patterns_capacity = 64;
+    d->nb_patterns = 0;
+    d->patterns = malloc(d->patterns_capacity * PATTERN_SIZE * sizeof(uint));
+    assert(d->cross_need && d->cross_left && d->tree_mask && d->patterns);
+
+    for (uint p = 0; p < d->width; p++)
+        d->cross_need[p] = d->transposed ? s->row_need[p] : s->col_need[p];
+    for (uint line = d->nb_lines; line-- > 0;)
+        for (uint p = 0; p < d->width; p++)
+            d->cross_left[line * d->width + p] = d->cross_left[(line + 1) * d->width + p] +
+                                                 (s->value[line_cell(d, line, p)] != SOLVER_GRASS);
+    for (uint t = 0; t < s->nb_trees; t++)
+        d->tree_mask[cell_line(d, s->tree_cell[t])] |= 1u << cell_pos(d, s->tree_cell[t]);
+    return d;
+}
+
+static void dp_delete(dp d) {
+    free(d->cross_need);
+    free(d->cross_left);
+    free(d->tree_mask);
+    free(d->patterns);
+    free(d);
+}
+
+// Lists the patterns of line in the patterns of d
+static void line_patterns(dp d, uint line) {
+    d->nb_patterns = 0;
+    const pattern_table *t = d->transposed ? &d->s->col_patterns : &d->s->row_patterns;
+    uint need = line_need(d, line);
+    if (t->masks == NULL)
+        add_patterns(d, line, 0, 0, need);
+    else if (need <= d->width) {  // The patterns of the table with a tent on every tent of the line and none on grass
+        uint tents = 0, allowed = 0;
+        for (uint p = 0; p < d->width; p++) {
+            tents |= (uint)(d->s->value[line_cell(d, line, p)] == SOLVER_TENT) << p;
+            allowed |= (uint)(d->s->value[line_cell(d, line, p)] != SOLVER_GRASS) << p;
+        }
+        for (uint k = t->first[need]; k < t->first[need + 1]; k++)
+            if ((t->masks[k] & ~allowed) == 0 && (t->masks[k] & tents) == tents)
+                keep_pattern(d, line, t->masks[k]);
+    }
+}
+
+// Fills key with the state reached from state by the pattern on line (down: trees of line covered by the pattern of
+// state). Returns false if the pattern can't follow the state.
+static bool follow(dp d, uint line, const uint *state, uint key_size, const uint *pattern, uint down, uint *key) {
+    uint m = pattern[PATTERN_MASK];
+    if (pattern[PATTERN_CONFLICTS] & state[KEY_MASK])
+        return false;
+    memcpy(key, state, key_size * sizeof(uint));
+    if (line > 0) {
+        uint pending = state[KEY_PENDING] & ~pattern[PATTERN_COVER];
+        if (line == 1 && d->s->wrapping)  // The first line may still get tents from the last one
+            key[KEY_FIRST_PENDING] = pending;
+        else if (pending != 0)
+            return false;
+    }
+    for (uint p = 0; p < d->width; p++) {
+        key[KEY_COUNTS + p] += m >> p & 1;
+        if (key[KEY_COUNTS + p] > d->cross_need[p] ||
+            key[KEY_COUNTS + p] + d->cross_left[(line + 1) * d->width + p] < d->cross_need[p])
+            return false;
+    }
+    key[KEY_MASK] = m;
+    key[KEY_PENDING] = d->tree_mask[line] & ~(down | pattern[PATTERN_COVER_SELF]);
+    if (line == 0)
+        key[KEY_FIRST] = m;
+    return true;
+}
+
+// Extends every state of cur with every pattern of line into next. Returns false if there are too many states.
+static bool extend(dp d, uint line, table cur, table next, uint *key) {
+    line_patterns(d, line);
+    for (uint x = 0; x < cur->nb; x++) {
+        const uint *state = cur->keys + x * cur->key_size;
+        uint down = line > 0 ? cover(d, line - 1, state[KEY_MASK], line) : 0;
+        for (uint k = 0; k < d->nb_patterns; k++)
+            if (follow(d, line, state, cur->key_size, d->patterns + k * PATTERN_SIZE, down, key))
+                table_add(d->s, next, key, cur->counts[x]);
+        if (next->nb > MAX_STATES)
+            return false;
+    }
+    return true;
+}
+
+// Whether a state reached after the last line is a solution
+static bool complete(dp d, const uint *state) {
+    uint last = d->nb_lines - 1;
+    bool done = true;
+    for (uint p = 0; p < d->width; p++)
+        done &= state[KEY_COUNTS + p] == d->cross_need[p];
+    if (d->s->wrapping) {  // The first and the last lines are next to each other
+        done &= !(conflicts(d, 0, state[KEY_FIRST], last) & state[KEY_MASK]);
+        done &= !(state[KEY_PENDING] & ~cover(d, 0, state[KEY_FIRST], last));
+        done &= !(state[KEY_FIRST_PENDING] & ~cover(d, last, state[KEY_MASK], 0));
+    } else
+        done &= state[KEY_PENDING] == 0;
+    return done;
+}
+
+// Whether the board can be counted line by line (see solver_dp_count). Sets *nb_sol to 0 if it can.
+static bool dp_usable(solver s, uint max_width, uint64_t *nb_sol) {
+    uint width = s->nb_cols > s->nb_rows ? s->nb_rows : s->nb_cols;
+    uint length = s->nb_cols > s->nb_rows ? s->nb_cols : s->nb_rows;
+    if (width > max_width || width > 32 || (s->wrapping && length < 3))
+        return false;
+    *nb_sol = 0;
+    return true;
+}
+
+// Same necessary condition as the native search
+static bool sums_match(solver s) {
+    uint sum_rows = 0, sum_cols = 0;
+    for (uint i = 0; i < s->nb_rows; i++)
+        sum_rows += s->row_need[i];
+    for (uint j = 0; j < s->nb_cols; j++)
+        sum_cols += s->col_need[j];
+    return sum_rows == s->nb_trees && sum_cols == s->nb_trees;
+}
+
+bool solver_dp_count(solver s, uint max_width, uint64_t *nb_sol) {
+    assert(s && nb_sol);
+    if (!dp_usable(s, max_width, nb_sol))
+        return false;
+    if (!sums_match(s))
+        return true;
+
+    dp d = dp_new(s);
+    uint key_size = KEY_COUNTS + d->width;
+    uint *key = calloc(key_size, sizeof(uint));
+    table cur = table_new(key_size), next = table_new(key_size);
+    assert(key);
+    table_add(s, cur, key, 1);
+
+    bool ok = true;
+    for (uint line = 0; line < d->nb_lines && ok; line++) {
+        table_clear(next);
+        ok = extend(d, line, cur, next, key);
+        table tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+
+    for (uint x = 0; ok && x < cur->nb; x++)
+        if (complete(d, cur->keys + x * key_size))
+            *nb_sol = solver_count_add(s, *nb_sol, cur->counts[x]);
+
+    table_delete(cur);
+    table_delete(next);
+    free(key);
+    dp_delete(d);
+    return ok;
+}
+
+/* ************************************************************************** */
+/*                                  SAMPLE                                    */
+/* ************************************************************************** */
+
+/* A solution is drawn backwards: the tables of every line are kept, a final state is drawn with a probability
+ * proportional to its number of ways, then for each line from the last one a state of the line before and a pattern
+ * leading to the state drawn, with a probability proportional to the number of ways to reach that state before.
+ */
+
+// Draws one of the pairs (state of before, pattern of line) leading to the state target, and returns the state
+static uint draw_before(dp d, uint line, table before, const uint *target, uint *key, uint64_t *rng, uint *mask) {
+    line_patterns(d, line);
+    uint64_t total = 0, r = 0;
+    for (uint pass = 0; pass < 2; pass++) {  // Sums the ways, then finds the pair drawn among them
+        if (pass == 1)
+            r = solver_random(rng, total);
+        for (uint x = 0; x < before->nb; x++) {
+            const uint *state = before->keys + x * before->key_size;
+            uint down = line > 0 ? cover(d, line - 1, state[KEY_MASK], line) : 0;
+            for (uint k = 0; k < d->nb_patterns; k++) {
+                const uint *pattern = d->patterns + k * PATTERN_SIZE;
+                if (!follow(d, line, state, before->key_size, pattern, down, key) ||
+                    memcmp(key, target, before->key_size * sizeof(uint)) != 0)
+                    continue;
+                if (pass == 0)
+                    total = solver_count_add(d->s, total, before->counts[x]);
+                else if (r < before->counts[x]) {
+                    *mask = pattern[PATTERN_MASK];
+                    return x;
+                } else
+                    r -= before->counts[x];
+            }
+        }
+    }
+    assert(false);  // The state target was reached from before
+    return 0;
+}
+
+bool solver_dp_sample(solver s, uint max_width, uint64_t *rng, bool *found) {
+    assert(s && rng && found);
+    uint64_t nb_sol;
+    if (!dp_usable(s, max_width, &nb_sol))
+        return false;
+    *found = false;
+    if (!sums_match(s))
+        return true;
+
+    dp d = dp_new(s);
+    uint key_size = KEY_COUNTS + d->width;
+    uint *key = calloc(key_size, sizeof(uint));
+    table *tables = malloc((d->nb_lines + 1) * sizeof(table));  // tables[line + 1]: the states after line
+    assert(key && tables);
+    tables[0] = table_new(key_size);
+    table_add(s, tables[0], key, 1);
+    bool ok = true;
+    uint nb_tables = 1;
+    for (uint line = 0; line < d->nb_lines && ok; line++) {
+        tables[nb_tables] = table_new(key_size);
+        ok = extend(d, line, tables[nb_tables - 1], tables[nb_tables], key);
+        nb_tables++;
+    }
+
+    table last = tables[d->nb_lines];
+    for (uint x = 0; ok && x < last->nb; x++)
+        if (complete(d, last->keys + x * key_size))
+            nb_sol = solver_count_add(s, nb_sol, last->counts[x]);
+    *found = ok && nb_sol > 0;
+
+    if (*found) {
+        uint x = 0;
+        for (uint64_t r = solver_random(rng, nb_sol);; x++)
+            if (complete(d, last->keys + x * key_size)) {
+                if (r < last->counts[x])
+                    break;
+                r -= last->counts[x];
+            }
+        uint *target = malloc(key_size * sizeof(uint));
+        uint *masks = malloc(d->nb_lines * sizeof(uint));
+        assert(target && masks);
+        for (uint line = d->nb_lines; line-- > 0;) {
+            memcpy(target, tables[line + 1]->keys + x * key_size, key_size * sizeof(uint));
+            x = draw_before(d, line, tables[line], target, key, rng, &masks[line]);
+        }
+        for (uint line = 0; line < d->nb_lines; line++)
+            for (uint p = 0; p < d->width; p++) {
+                uint c = line_cell(d, line, p);
+                if (s->value[c] == SOLVER_UNKNOWN)
+                    solver_assign(s, c, masks[line] >> p & 1 ? SOLVER_TENT : SOLVER_GRASS);
+            }
+        free(target);
+        free(masks);
+    }
+
+    for (uint t = 0; t < nb_tables; t++)
+        table_delete(tables[t]);
+    free(tables);
+    free(key);
+    dp_delete(d);
+    return ok;
+}
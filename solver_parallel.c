@@ -0,0 +1,340 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header/solver.h"
+
+/* Parallel search with work stealing. The search tree is cut into cubes: a cube is the list of the decisions taken
+ * from the root to one of its nodes (as literals, 2 * square + 1 for grass, 2 * square for a tent). Every worker has
+ * its own solver and its own deque of cubes. A worker takes the last cube of its deque (the deepest one it pushed),
+ * or when its deque is empty the first cube of the deque of another worker (the shallowest one, so that a steal brings
+ * a large part of the tree). A cube shallower than split_depth is cut in two on the square chosen by the heuristic,
+ * and both halves go to the deque of the worker. The other cubes are searched by solver_search. When counting, the
+ * component cache of a worker is kept from one of its cubes to the next (see keep_cache), so that a component met in
+ * several cubes is only counted once by each worker.
+ * The threads of the workers are created by each count or search and joined at its end; the solvers are the caller's.
+ * When looking for a solution, the first worker finding one keeps its solver on it and sets the stop flag, which the
+ * other workers check between two cubes and solver_search between two decisions.
+ *
+ * The same cubes can be written down (see solver_split) to be counted by separate processes.
+ *
+ * The portfolio runs whole searches instead: every engine (a backend and its options) searches the board on its own
+ * thread, and the first one answering sets the same kind of stop flag.
+ * A native search running out of its budget sets the stop flag too, which ends the whole pool or race without
+ * answer.
+ */
+
+typedef struct cube_s {
+    uint depth;
+    uint *lits;
+} cube;
+
+typedef struct deque_s {
+    pthread_mutex_t lock;
+    cube *cubes;
+    uint head, tail, capacity;  // The cubes of the deque are cubes[head] to cubes[tail - 1]
+} deque;
+
+typedef struct pool_s {
+    solver *workers;
+    deque *deques;
+    uint nb_workers, split_depth;
+    uint64_t limit;        // 0 to count the solutions, 1 to look for one
+    uint64_t *nb_sol;      // Solutions found by each worker (added with the count arithmetic of its solver)
+    int stop;              // Set (atomically) when a solution is found with limit 1
+    pthread_mutex_t lock;  // Protects the fields below
+    uint64_t pending;      // Cubes pushed and not searched or cut yet
+    int winner;            // Worker left on the solution found, -1 if none
+} pool;
+
+typedef struct worker_arg_s {
+    pool *p;
+    uint id;
+} worker_arg;
+
+/* ************************************************************************** */
+/*                                  DEQUES                                    */
+/* ************************************************************************** */
+
+static void push(deque *d, cube c) {
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->capacity) {
+        if (d->head > 0) {  // Moves the cubes back to the start first
+            memmove(d->cubes, d->cubes + d->head, (d->tail - d->head) * sizeof(cube));
+            d->tail -= d->head;
+            d->head = 0;
+        }
+        if (d->tail == d->capacity) {
+            d->capacity *= 2;
+            d->cubes = realloc(d->cubes, d->capacity * sizeof(cube));
+            assert(d->cubes);
+        }
+    }
+    d->cubes[d->tail++] = c;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Takes the last cube (own deque) or the first one (steal). Returns false if the deque is empty.
+static bool take(deque *d, bool last, cube *c) {
+    pthread_mutex_lock(&d->lock);
+    bool found = d->head < d->tail;
+    if (found)
+        *c = last ? d->cubes[--d->tail] : d->cubes[d->head++];
+    if (d->head == d->tail)
+        d->head = d->tail = 0;
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+/* ************************************************************************** */
+/*                                 WORKERS                                    */
+/* ************************************************************************** */
+
+// Pushes the cube made of parent and the literal lit on the deque of the worker
+static void push_child(pool *p, uint id, const cube *parent, uint lit) {
+    cube c = {parent->depth + 1, malloc((parent->depth + 1) * sizeof(uint))};
+    assert(c.lits);
+    memcpy(c.lits, parent->lits, parent->depth * sizeof(uint));
+    c.lits[parent->depth] = lit;
+    pthread_mutex_lock(&p->lock);
+    p->pending++;
+    pthread_mutex_unlock(&p->lock);
+    push(&p->deques[id], c);
+}
+
+// Cuts the cube in two or searches it. The solver of the worker is restored afterwards, unless it is left on the
+// solution found (the worker is then the winner of the pool).
+static uint64_t process(pool *p, uint id, const cube *c) {
+    solver s = p->workers[id];
+    uint mark = s->trail_size;
+    bool ok = true;
+    for (uint k = 0; k < c->depth && ok; k++)
+        ok = solver_assign(s, c->lits[k] >> 1, (c->lits[k] & 1) ? SOLVER_GRASS : SOLVER_TENT);
+
+    // solver_search propagates the cube itself: only a cube to cut is propagated here, to choose its square
+    bool cut = ok && c->depth < p->split_depth;
+    if (cut) {
+        ok = solver_prepare(s);
+        cut = ok && s->nb_free > 0;
+    }
+    uint64_t nb_sol = 0;
+    if (cut) {
+        uint cell = s->heuristic(s);
+        push_child(p, id, c, 2 * cell + 1);
+        push_child(p, id, c, 2 * cell);
+    } else if (ok)
+        nb_sol = solver_search(s, p->limit);
+
+    if (p->limit != 0 && nb_sol > 0) {
+        pthread_mutex_lock(&p->lock);
+        bool first = p->winner == -1;
+        if (first)
+            p->winner = (int)id;
+        pthread_mutex_unlock(&p->lock);
+        __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+        if (first)
+            return nb_sol;
+    }
+    solver_undo(s, mark);
+    return nb_sol;
+}
+
+static void *work(void *arg) {
+    pool *p = ((worker_arg *)arg)->p;
+    uint id = ((worker_arg *)arg)->id;
+    while (!__atomic_load_n(&p->stop, __ATOMIC_RELAXED)) {
+        cube c = {0, NULL};
+        bool found = take(&p->deques[id], true, &c);
+        for (uint k = 1; k < p->nb_workers && !found; k++)
+            found = take(&p->deques[(id + k) % p->nb_workers], false, &c);
+        if (!found) {
+            pthread_mutex_lock(&p->lock);
+            bool done = p->pending == 0;
+            pthread_mutex_unlock(&p->lock);
+            if (done)
+                return NULL;
+            sched_yield();
+            continue;
+        }
+        p->nb_sol[id] = solver_count_add(p->workers[id], p->nb_sol[id], process(p, id, &c));
+        free(c.lits);
+        pthread_mutex_lock(&p->lock);
+        p->pending--;
+        pthread_mutex_unlock(&p->lock);
+    }
+    return NULL;
+}
+
+/* ************************************************************************** */
+/*                                   RUN                                      */
+/* ************************************************************************** */
+
+// Runs the workers on the whole search tree with the given limit (see pool)
+static void run(pool *p, solver *workers, uint nb_workers, uint64_t limit) {
+    assert(workers && nb_workers > 0);
+    p->workers = workers;
+    p->nb_workers = nb_workers;
+    p->deques = malloc(nb_workers * sizeof(deque));
+    p->nb_sol = calloc(nb_workers, sizeof(uint64_t));
+    assert(p->deques && p->nb_sol);
+    p->limit = limit;
+    p->stop = 0;
+    pthread_mutex_init(&p->lock, NULL);
+    p->pending = 1;
+    p->winner = -1;
+    p->split_depth = 6;  // About 2^6 cubes per worker
+    for (uint n = nb_workers; n > 1; n /= 2)
+        p->split_depth++;
+
+    for (uint w = 0; w < nb_workers; w++) {
+        pthread_mutex_init(&p->deques[w].lock, NULL);
+        p->deques[w].head = p->deques[w].tail = 0;
+        p->deques[w].capacity = 64;
+        p->deques[w].cubes = malloc(p->deques[w].capacity * sizeof(cube));
+        assert(p->deques[w].cubes);
+        workers[w]->stop = &p->stop;
+        if (limit == 0) {
+            solver_clear_cache(workers[w]);
+            workers[w]->keep_cache = true;
+        }
+    }
+    push(&p->deques[0], (cube){0, NULL});  // The root
+
+    pthread_t *threads = malloc(nb_workers * sizeof(pthread_t));
+    worker_arg *args = malloc(nb_workers * sizeof(worker_arg));
+    assert(threads && args);
+    for (uint w = 0; w < nb_workers; w++) {
+        args[w] = (worker_arg){p, w};
+        pthread_create(&threads[w], NULL, work, &args[w]);
+    }
+    for (uint w = 0; w < nb_workers; w++)
+        pthread_join(threads[w], NULL);
+
+    for (uint w = 0; w < nb_workers; w++) {
+        workers[w]->stop = NULL;
+        workers[w]->keep_cache = false;
+        for (uint k = p->deques[w].head; k < p->deques[w].tail; k++)  // Cubes left when the search was stopped
+            free(p->deques[w].cubes[k].lits);
+        pthread_mutex_destroy(&p->deques[w].lock);
+        free(p->deques[w].cubes);
+    }
+    pthread_mutex_destroy(&p->lock);
+    free(p->deques);
+    free(threads);
+    free(args);
+}
+
+uint64_t solver_parallel_count(solver *workers, uint nb_workers) {
+    pool p;
+    run(&p, workers, nb_workers, 0);
+    uint64_t nb_sol = p.nb_sol[0];
+    for (uint w = 1; w < nb_workers; w++) {
+        nb_sol = solver_count_add(workers[0], nb_sol, p.nb_sol[w]);
+        workers[0]->overflow |= workers[w]->overflow;
+    }
+    free(p.nb_sol);
+    return nb_sol;
+}
+
+int solver_parallel_solve(solver *workers, uint nb_workers) {
+    pool p;
+    run(&p, workers, nb_workers, 1);
+    free(p.nb_sol);
+    return p.winner;
+}
+
+/* ************************************************************************** */
+/*                                  SPLIT                                     */
+/* ************************************************************************** */
+
+// Cuts the node reached by the depth literals of lits like process, and emits the cubes of the leaves. Returns false
+// as soon as emit fails.
+static bool split(solver s, uint *lits, uint depth, uint max_depth, solver_cube_fn emit, void *data, uint *nb_cubes) {
+    uint mark = s->trail_size;
+    bool ok = depth == 0 || solver_assign(s, lits[depth - 1] >> 1, (lits[depth - 1] & 1) ? SOLVER_GRASS : SOLVER_TENT);
+    ok = ok && solver_prepare(s);
+    bool kept = true;
+    if (ok && (depth == max_depth || s->nb_free == 0)) {
+        kept = emit(lits, depth, data);
+        *nb_cubes += kept;
+    } else if (ok) {
+        uint cell = s->heuristic(s);
+        lits[depth] = 2 * cell + 1;
+        kept = split(s, lits, depth + 1, max_depth, emit, data, nb_cubes);
+        lits[depth] = 2 * cell;
+        kept = kept && split(s, lits, depth + 1, max_depth, emit, data, nb_cubes);
+    }
+    solver_undo(s, mark);
+    return kept;
+}
+
+bool solver_split(solver s, uint max_depth, solver_cube_fn emit, void *data, uint *nb_cubes) {
+    assert(s && emit && nb_cubes);
+    uint *lits = malloc((max_depth + 1) * sizeof(uint));
+    assert(lits);
+    *nb_cubes = 0;
+    bool ok = split(s, lits, 0, max_depth, emit, data, nb_cubes);
+    free(lits);
+    return ok;
+}
+
+/* ************************************************************************** */
+/*                                PORTFOLIO                                   */
+/* ************************************************************************** */
+
+typedef struct race_s {
+    solver *engines;
+    const solver_search_fn *searches;
+    int stop;
+    pthread_mutex_t lock;  // Protects the fields below
+    int winner;
+    bool found;
+} race;
+
+typedef struct engine_arg_s {
+    race *r;
+    uint id;
+} engine_arg;
+
+static void *run_engine(void *arg) {
+    race *r = ((engine_arg *)arg)->r;
+    uint id = ((engine_arg *)arg)->id;
+    uint64_t nb_sol = r->searches[id](r->engines[id], 1);
+    // An engine interrupted by the stop flag ends after it was set, either by the winner, which claims the race first,
+    // or by an engine out of budget: neither kind of engine has an answer
+    pthread_mutex_lock(&r->lock);
+    if (r->winner == -1 && !__atomic_load_n(&r->stop, __ATOMIC_RELAXED)) {
+        r->winner = (int)id;
+        r->found = nb_sol > 0;
+        __atomic_store_n(&r->stop, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+int solver_portfolio_solve(solver *engines, const solver_search_fn *searches, uint nb_engines, bool *found) {
+    assert(engines && searches && nb_engines > 0 && found);
+    race r = {engines, searches, 0, PTHREAD_MUTEX_INITIALIZER, -1, false};
+    pthread_t *threads = malloc(nb_engines * sizeof(pthread_t));
+    engine_arg *args = malloc(nb_engines * sizeof(engine_arg));
+    assert(threads && args);
+    for (uint e = 0; e < nb_engines; e++) {
+        engines[e]->stop = &r.stop;
+        args[e] = (engine_arg){&r, e};
+        pthread_create(&threads[e], NULL, run_engine, &args[e]);
+    }
+    for (uint e = 0; e < nb_engines; e++) {
+        pthread_join(threads[e], NULL);
+        engines[e]->stop = NULL;
+    }
+    pthread_mutex_destroy(&r.lock);
+    free(threads);
+    free(args);
+    *found = r.found;
+    return r.winner;
+}
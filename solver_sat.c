@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "header/sat.h"
+#include "header/solver.h"
+
+/* ************************************************************************** */
+/*                                 ENCODING                                   */
+/* ************************************************************************** */
+
+/* The squares still unknown in the solver become the variables of the formula (true for a tent). The squares already
+ * decided are constants: they are folded into the clauses below.
+ *      -> Rule 1: for two squares in conflict (see solver.h), one of them is not a tent.
+ *      -> Rules 2 and 3: exactly the expected number of tents on each line, with a sequential counter.
+ *      -> Rule 4: every tree has a tent around it (a tent may touch several trees, so the trees are not paired with
+ *         the tents and one variable per square is enough).
+ * A tent can only stand next to a tree because the squares left to decide by game_tools.c are all next to a tree.
+ */
+
+static void unit(sat f, uint a) {
+    sat_add_clause(f, &a, 1);
+}
+
+static void binary(sat f, uint a, uint b) {
+    uint lits[] = {a, b};
+    sat_add_clause(f, lits, 2);
+}
+
+/* Encodes "exactly k of the n literals x are true" with a sequential counter: the variable r[i][j] is true if and only
+ * if at least j + 1 of the literals x[0..i] are true (j goes up to k, so that k + 1 can be forbidden).
+ */
+static void exactly(sat f, const uint *x, uint n, uint k) {
+    if (k > n) {
+        sat_add_clause(f, NULL, 0);
+        return;
+    }
+    if (k == 0 || k == n) {  // Every literal gets the same value
+        for (uint i = 0; i < n; i++)
+            unit(f, k == 0 ? x[i] ^ 1 : x[i]);
+        return;
+    }
+
+    uint *r = malloc(n * (k + 1) * sizeof(uint));
+    assert(r);
+    for (uint v = 0; v < n * (k + 1); v++)
+        r[v] = SAT_LIT(sat_new_var(f), true);
+
+    for (uint i = 0; i < n; i++)
+        for (uint j = 0; j <= k; j++) {
+            uint cur = r[i * (k + 1) + j];
+            if (i == 0) {  // At least j + 1 of x[0..0]: x[0] if j is 0, impossible otherwise
+                binary(f, cur ^ 1, x[0]);
+                if (j == 0)
+                    binary(f, x[0] ^ 1, cur);
+                else
+                    unit(f, cur ^ 1);
+                continue;
+            }
+            uint prev = r[(i - 1) * (k + 1) + j];
+            binary(f, prev ^ 1, cur);  // Counts never decrease
+            uint up[] = {cur ^ 1, prev, x[i]};  // A new count needs x[i]...
+            sat_add_clause(f, up, 3);
+            if (j == 0) {
+                binary(f, x[i] ^ 1, cur);
+                continue;
+            }
+            uint below = r[(i - 1) * (k + 1) + j - 1];
+            uint step[] = {x[i] ^ 1, below ^ 1, cur};
+            sat_add_clause(f, step, 3);
+            uint from[] = {cur ^ 1, prev, below};  // ... and the count just below on x[0..i - 1]
+            sat_add_clause(f, from, 3);
+        }
+
+    unit(f, r[(n - 1) * (k + 1) + k - 1]);
+    unit(f, r[(n - 1) * (k + 1) + k] ^ 1);
+    free(r);
+}
+
+// Encodes the line of len squares starting at first (step 1 for a row, nb_cols for a column) expecting need tents
+static void encode_line(solver s, sat f, const uint *var, uint *x, uint first, uint step, uint len, uint need) {
+    uint n = 0, tents = 0;
+    for (uint k = 0; k < len; k++) {
+        uint c = first + k * step;
+        if (s->value[c] == SOLVER_TENT)
+            tents++;
+        else if (s->value[c] == SOLVER_UNKNOWN)
+            x[n++] = SAT_LIT(var[c], true);
+    }
+    if (tents > need)
+        sat_add_clause(f, NULL, 0);
+    else
+        exactly(f, x, n, need - tents);
+}
+
+// Builds the formula of the current state of the solver. var receives the variable of every unknown square.
+static sat encode(solver s, uint *var) {
+    sat f = sat_new();
+    uint *x = malloc(s->nb_cells * sizeof(uint));
+    assert(x);
+
+    uint sum_rows = 0, sum_cols = 0;
+    for (uint i = 0; i < s->nb_rows; i++)
+        sum_rows += s->row_need[i];
+    for (uint j = 0; j < s->nb_cols; j++)
+        sum_cols += s->col_need[j];
+    if (sum_rows != s->nb_trees || sum_cols != s->nb_trees)  // Same necessary condition as the native search
+        sat_add_clause(f, NULL, 0);
+
+    for (uint c = 0; c < s->nb_cells; c++)
+        if (s->value[c] == SOLVER_UNKNOWN)
+            var[c] = sat_new_var(f);
+
+    // Rule 1
+    for (uint c = 0; c < s->nb_cells; c++) {
+        if (s->value[c] == SOLVER_GRASS)
+            continue;
+        for (uint k = 0; k < s->cell_nb_conf[c]; k++) {
+            uint d = s->cell_conf[c * MAX_CONF + k];
+            if (s->value[d] == SOLVER_GRASS || (d < c && s->value[d] == SOLVER_UNKNOWN && s->value[c] == SOLVER_UNKNOWN))
+                continue;
+            uint lits[2], size = 0;
+            if (s->value[c] == SOLVER_UNKNOWN)
+                lits[size++] = SAT_LIT(var[c], false);
+            if (s->value[d] == SOLVER_UNKNOWN && d != c)
+                lits[size++] = SAT_LIT(var[d], false);
+            sat_add_clause(f, lits, size);
+        }
+    }
+
+    // Rules 2 and 3
+    for (uint i = 0; i < s->nb_rows; i++)
+        encode_line(s, f, var, x, i * s->nb_cols, 1, s->nb_cols, s->row_need[i]);
+    for (uint j = 0; j < s->nb_cols; j++)
+        encode_line(s, f, var, x, j, s->nb_cols, s->nb_rows, s->col_need[j]);
+
+    // Rule 4
+    for (uint t = 0; t < s->nb_trees; t++) {
+        if (s->tree_tents[t] > 0)
+            continue;
+        uint n = 0;
+        for (uint k = 0; k < s->tree_nb_cand[t]; k++) {
+            uint c = s->tree_cand[t * MAX_TREES + k];
+            if (s->value[c] == SOLVER_UNKNOWN)
+                x[n++] = SAT_LIT(var[c], true);
+        }
+        sat_add_clause(f, x, n);
+    }
+
+    free(x);
+    return f;
+}
+
+/* ************************************************************************** */
+/*                                  SEARCH                                    */
+/* ************************************************************************** */
+
+typedef struct sat_search {
+    solver s;
+    sat f;
+} sat_search;
+
+/* The decisions of the SAT solver are the nodes of the budget, like the choices of the dancing links. The memory of
+ * the formula, learned clauses included, is checked with the one of the solver every 64 decisions.
+ */
+static bool sat_interrupted(void *data) {
+    sat_search *x = data;
+    solver s = x->s;
+    if (s->max_memory != 0 && s->nb_decisions % 64 == 0 && solver_memory(s) + sat_memory(x->f) > s->max_memory) {
+        s->out_of_limits = true;
+        if (s->stop != NULL)
+            __atomic_store_n(s->stop, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    if (solver_interrupted(s))
+        return true;
+    s->nb_decisions++;
+    return false;
+}
+
+/* Every model found is excluded by a clause over the squares (the other variables only depend on the squares), so
+ * that the next call to the SAT solver looks for another solution. When looking for solutions, the SAT solver is
+ * interrupted like the native search: by the stop flag of the solver, by its cancel flag when it runs alone, or when
+ * the budget runs out (the deadline, max_decisions and max_memory of the solver).
+ */
+uint64_t solver_sat_search(solver s, uint64_t limit) {
+    assert(s);
+    uint *var = malloc(s->nb_cells * sizeof(uint));
+    uint *block = malloc(s->nb_cells * sizeof(uint));
+    assert(var && block);
+    sat f = encode(s, var);
+    sat_search x = {s, f};
+    if (limit != 0)
+        sat_set_interrupt(f, sat_interrupted, &x);
+    uint64_t nb_sol = 0;
+
+    while (sat_solve(f)) {
+        nb_sol++;
+        if (limit != 0 && nb_sol >= limit) {  // Leaves the solver on the solution
+            for (uint c = 0; c < s->nb_cells; c++)
+                if (s->value[c] == SOLVER_UNKNOWN)
+                    solver_assign(s, c, sat_model_value(f, var[c]) ? SOLVER_TENT : SOLVER_GRASS);
+            break;
+        }
+        uint n = 0;
+        for (uint c = 0; c < s->nb_cells; c++)
+            if (s->value[c] == SOLVER_UNKNOWN)
+                block[n++] = SAT_LIT(var[c], !sat_model_value(f, var[c]));
+        sat_add_clause(f, block, n);
+    }
+
+    s->nb_conflicts += sat_nb_conflicts(f);
+    sat_delete(f);
+    free(var);
+    free(block);
+    return nb_sol;
+}